@@ -0,0 +1,56 @@
+#include "Binding.hpp"
+#include "../Document/Document.hpp"
+#include <algorithm>
+
+namespace Lucid {
+	namespace Binding {
+		Observable::~Observable()
+		{
+			// Unbind removes the target, so work on a copy
+			std::vector<Target> bound = targets;
+			for (const Target& target : bound) {
+				target.document->Unbind(target.id);
+			}
+		}
+
+		void Observable::AddBinding(Document& document, const std::string& id)
+		{
+			Target target{ &document, id };
+			if (std::find(targets.begin(), targets.end(), target) == targets.end()) {
+				targets.push_back(std::move(target));
+			}
+		}
+
+		void Observable::RemoveBinding(Document& document, const std::string& id)
+		{
+			std::erase(targets, Target{ &document, id });
+		}
+
+		void Observable::Mute(Document& document, const std::string& id)
+		{
+			muted = Target{ &document, id };
+		}
+
+		void Observable::Unmute()
+		{
+			muted = Target{ nullptr };
+		}
+
+		void Observable::Notify()
+		{
+			++version;
+
+			// Only converted when some element still needs it
+			std::string text;
+			bool converted = false;
+			for (const Target& target : targets) {
+				if (target == muted) continue;
+				if (!converted) {
+					text = ToText();
+					converted = true;
+				}
+				target.document->SetText(target.document->GetElementById(target.id), text);
+			}
+		}
+	}
+}
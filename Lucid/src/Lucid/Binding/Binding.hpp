@@ -0,0 +1,133 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <charconv>
+#include <functional>
+#include <type_traits>
+
+namespace Lucid {
+	class Document;
+
+	namespace Binding {
+		/* ---Formatting--- */
+		inline std::string ToString(const std::string& value) { return value; }
+		inline std::string ToString(bool value) { return value ? "true" : "false"; }
+
+		template<typename T>
+		inline std::enable_if_t<std::is_arithmetic_v<T>, std::string> ToString(T value)
+		{
+			char buffer[64];
+			auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+			return std::string(buffer, result.ptr);
+		}
+
+		template<typename T>
+		inline std::string ToString(const std::vector<T>& values)
+		{
+			std::string text;
+			for (size_t i = 0; i < values.size(); ++i) {
+				if (i > 0) text += ", ";
+				text += ToString(values[i]);
+			}
+			return text;
+		}
+
+		// Type-erased side of a binding, this is what the document keeps track of
+		class Observable {
+		public:
+			Observable() = default;
+			// Bindings refer to the value by address, so it can't be copied around
+			Observable(const Observable&) = delete;
+			Observable& operator=(const Observable&) = delete;
+			virtual ~Observable();
+
+			virtual std::string ToText() const = 0;
+
+			// Called by Document::Bind / Unbind, a value can be shown by any number of elements across documents
+			void AddBinding(Document& document, const std::string& id);
+			void RemoveBinding(Document& document, const std::string& id);
+			// Notify leaves this binding out until unmuted, for an element that was given the change directly
+			void Mute(Document& document, const std::string& id);
+			void Unmute();
+			// Goes up by one on every change, lets holders of a copy tell whether it is stale
+			uint64_t Version() const { return version; }
+
+		protected:
+			// Pushes the value into the bound elements, which are then relaid out on the next flush
+			void Notify();
+
+		private:
+			struct Target {
+				Document* document;
+				std::string id;
+
+				bool operator==(const Target& other) const = default;
+			};
+
+			std::vector<Target> targets;
+			Target muted{ nullptr };
+			uint64_t version = 0;
+		};
+	}
+
+	// A model value that updates the elements bound to it whenever it changes.
+	// Supports strings, numbers, bools and vectors of those
+	template<typename T>
+	class Bindable : public Binding::Observable {
+	public:
+		using Listener = std::function<void(const T&)>;
+
+		Bindable() = default;
+		Bindable(T value) : value(std::move(value)) {}
+
+		const T& Get() const { return value; }
+		operator const T&() const { return value; }
+
+		void Set(T newValue)
+		{
+			if (value == newValue) return;
+
+			value = std::move(newValue);
+			Changed();
+		}
+
+		Bindable& operator=(T newValue)
+		{
+			Set(std::move(newValue));
+			return *this;
+		}
+
+		// Edits the value in place (appending to a string or list) and notifies once
+		template<typename Edit>
+		void Modify(Edit&& edit)
+		{
+			edit(value);
+			Changed();
+		}
+
+		// Listeners are called after the bound elements have been marked for update
+		void OnChange(Listener listener)
+		{
+			listeners.push_back(std::move(listener));
+		}
+
+		std::string ToText() const override
+		{
+			return Binding::ToString(value);
+		}
+
+	private:
+		void Changed()
+		{
+			Notify();
+			for (const Listener& listener : listeners) {
+				listener(value);
+			}
+		}
+
+		T value{};
+		std::vector<Listener> listeners;
+	};
+}
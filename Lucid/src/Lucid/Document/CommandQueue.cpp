@@ -0,0 +1,80 @@
+#include "CommandQueue.hpp"
+
+namespace Lucid {
+	CommandQueue::~CommandQueue()
+	{
+		Node* node = head.exchange(nullptr, std::memory_order_acquire);
+		while (node) {
+			Node* next = node->next;
+			delete node;
+			node = next;
+		}
+	}
+
+	bool CommandQueue::Push(Command command)
+	{
+		Node* node = new Node{ std::move(command) };
+
+		Node* expected = head.load(std::memory_order_relaxed);
+		do {
+			node->next = expected;
+		} while (!head.compare_exchange_weak(expected, node, std::memory_order_release, std::memory_order_relaxed));
+
+		return expected == nullptr;
+	}
+
+	std::string CommandQueue::CoalesceKey(const Command& command)
+	{
+		// Adding and removing the same class replace each other
+		Command::Kind kind = (command.kind == Command::RemoveClass) ? Command::AddClass : command.kind;
+
+		std::string key(1, static_cast<char>(kind));
+		key += command.id;
+		key += '\0';
+		key += command.name;
+		return key;
+	}
+
+	std::vector<Command> CommandQueue::Drain()
+	{
+		Node* node = head.exchange(nullptr, std::memory_order_acquire);
+		if (!node) return {};
+
+		// The list runs newest to oldest, so the first command seen for a key is the one that wins
+		std::vector<Node*> kept;
+		std::unordered_set<std::string> seenKeys;
+		std::unordered_set<const void*> seenTargets;
+
+		while (node) {
+			Node* next = node->next;
+			const Command& command = node->command;
+
+			bool newest = true;
+			if (command.kind == Command::Call) {
+				if (command.target) newest = seenTargets.insert(command.target).second;
+			}
+			else {
+				newest = seenKeys.insert(CoalesceKey(command)).second;
+			}
+
+			if (newest) kept.push_back(node);
+			else delete node;
+
+			node = next;
+		}
+
+		std::vector<Command> commands;
+		commands.reserve(kept.size());
+		for (auto it = kept.rbegin(); it != kept.rend(); ++it) {
+			commands.push_back(std::move((*it)->command));
+			delete *it;
+		}
+
+		return commands;
+	}
+
+	bool CommandQueue::Empty() const
+	{
+		return head.load(std::memory_order_relaxed) == nullptr;
+	}
+}
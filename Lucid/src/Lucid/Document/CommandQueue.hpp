@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_set>
+
+namespace Lucid {
+	class Document;
+
+	// A change posted from some thread, applied on the document's own thread during its next Update
+	struct Command {
+		enum Kind {
+			SetText,
+			SetAttribute,
+			SetStyle,
+			AddClass,
+			RemoveClass,
+			Call
+		};
+
+		Kind kind = Call;
+		std::string id;    // element the change is for
+		std::string name;  // attribute, style property or class name
+		std::string value;
+
+		// Call only: commands with the same target replace each other, nullptr is never replaced
+		const void* target = nullptr;
+		std::function<void(Document&)> call;
+	};
+
+	// Multi-producer single-consumer queue that never blocks either side.
+	// Producers push onto an atomic list head, the consumer takes the whole list with one exchange
+	class CommandQueue {
+	public:
+		CommandQueue() = default;
+		CommandQueue(const CommandQueue&) = delete;
+		CommandQueue& operator=(const CommandQueue&) = delete;
+		~CommandQueue();
+
+		// Safe from any thread. Returns true if the queue was empty, i.e. the consumer may be waiting for it
+		bool Push(Command command);
+
+		// Consumer only. Returns the queued commands in the order they were pushed, keeping only the
+		// last one for each element and property (last write wins)
+		std::vector<Command> Drain();
+
+		/* ---Getters--- */
+		bool Empty() const;
+
+	private:
+		struct Node {
+			Command command;
+			Node* next = nullptr;
+		};
+
+		static std::string CoalesceKey(const Command& command);
+
+		std::atomic<Node*> head = nullptr;
+	};
+}
@@ -0,0 +1,1333 @@
+#include "Document.hpp"
+
+namespace fs = std::filesystem;
+
+namespace Lucid {
+	Document::~Document()
+	{
+		// The watcher and loader threads post into this document
+		watcher.Stop();
+
+		++loadGeneration;
+		for (PageLoad& load : pageLoads) {
+			load.thread.join();
+			// Its result may be sitting in the command queue, which is never applied now
+			if (!load.result->delivered) load.result->promise.set_value(false);
+		}
+
+		// Values may outlive the document, they must not point back into it
+		for (const auto& [id, value] : boundValues) {
+			value->RemoveBinding(*this, id);
+		}
+	}
+
+	void Document::LoadPage(const std::string& htmlPath, std::string CSSPath)
+	{
+		auto files = OpenFiles(htmlPath, CSSPath);
+		LoadPageSource(files.first, files.second, fs::path(htmlPath).parent_path());
+
+		this->htmlPath = htmlPath;
+		this->cssPath = CSSPath;
+
+		// Follow the new files if we were watching the old ones
+		if (hotReload) EnableHotReload();
+	}
+
+	void Document::LoadPageSource(const std::string& html, const std::string& css, const fs::path& baseDirectory)
+	{
+		// Supersedes any page still loading in the background
+		++loadGeneration;
+
+		htmlPath.clear();
+		cssPath.clear();
+		this->baseDirectory = baseDirectory;
+
+		styleSheet = parseCSS(css);
+
+		std::shared_ptr<HTMLElement> page = ParseHTML(html);
+		styleCache.Clear();
+		processCSS(*page, styleSheet, styleCache);
+		TrimStyleCache();
+
+		LoadPage(page);
+
+		if (hotReload) EnableHotReload();
+	}
+
+	void Document::LoadPage(const std::shared_ptr<HTMLElement>& node)
+	{
+		if (!node) return;
+
+		++loadGeneration;
+
+		root = node;
+		dirtyElements.clear();
+
+		RebuildElements();
+	}
+
+	std::future<bool> Document::LoadPageAsync(const std::string& htmlPath, std::string CSSPath, std::function<void(bool)> onLoaded)
+	{
+		uint64_t generation = ++loadGeneration;
+		auto result = std::make_shared<LoadResult>();
+		std::future<bool> loaded = result->promise.get_future();
+
+		// Loads that were cancelled or finished have nothing left to wait for
+		std::erase_if(pageLoads, [](PageLoad& load) {
+			if (!load.finished->load() || !load.result->delivered) return false;
+			load.thread.join();
+			return true;
+		});
+
+		auto finished = std::make_shared<std::atomic<bool>>(false);
+		std::thread thread([this, htmlPath, CSSPath, onLoaded, result, generation, finished, viewport = viewportSize]() {
+			auto cancelled = [this, generation]() {
+				return loadGeneration.load() != generation;
+			};
+			// The result is always delivered on the document's thread
+			auto finish = [this, result, onLoaded](bool loaded, std::shared_ptr<Document> staged) {
+				Post([result, onLoaded, loaded, staged](Document& document) {
+					bool swapped = loaded && staged && document.AdoptPage(*staged);
+					result->promise.set_value(swapped);
+					result->delivered = true;
+					if (onLoaded) onLoaded(swapped);
+				});
+			};
+
+			if (!fs::exists(htmlPath)) {
+				std::cout << "Failed to load page, no such file: " << htmlPath << std::endl;
+				finish(false, nullptr);
+			}
+			else {
+				// Everything up to the finished layout happens in a staging document, the live one keeps rendering
+				auto staged = std::make_shared<Document>();
+				staged->loadGeneration = generation;
+				staged->htmlPath = htmlPath;
+				staged->cssPath = CSSPath;
+				staged->baseDirectory = fs::path(htmlPath).parent_path();
+				staged->viewportSize = viewport;
+
+				auto files = OpenFiles(htmlPath, CSSPath);
+				std::shared_ptr<HTMLElement> page;
+				if (!cancelled()) {
+					staged->styleSheet = parseCSS(files.second);
+					page = ParseHTML(files.first);
+				}
+				if (!cancelled()) {
+					processCSS(*page, staged->styleSheet, staged->styleCache);
+				}
+				if (!cancelled()) {
+					staged->root = page;
+					staged->RebuildElements();
+					staged->BuildBackgrounds();
+				}
+
+				finish(!cancelled(), cancelled() ? nullptr : staged);
+			}
+
+			finished->store(true);
+		});
+
+		pageLoads.push_back({ std::move(thread), finished, result });
+		return loaded;
+	}
+
+	// Swaps the staged page in as a whole, between two frames
+	bool Document::AdoptPage(Document& staged)
+	{
+		// A newer load, or a synchronous one, got here first
+		if (staged.loadGeneration != loadGeneration) return false;
+
+		// Pending changes point into the old tree
+		dirtyElements.clear();
+		hoveredElement = nullptr;
+
+		htmlPath = std::move(staged.htmlPath);
+		cssPath = std::move(staged.cssPath);
+		baseDirectory = std::move(staged.baseDirectory);
+		root = std::move(staged.root);
+		styleSheet = std::move(staged.styleSheet);
+		styleCache = std::move(staged.styleCache);
+		elementsById = std::move(staged.elementsById);
+		elementsByClass = std::move(staged.elementsByClass);
+		textElements = std::move(staged.textElements);
+		renderedNodes = std::move(staged.renderedNodes);
+		imageElements = std::move(staged.imageElements);
+		imageNodes = std::move(staged.imageNodes);
+		imageVersion = UINT64_MAX;
+		boxes = std::move(staged.boxes);
+		backgrounds = std::move(staged.backgrounds);
+		backgroundsDirty = staged.backgroundsDirty;
+		visibleVersion = UINT64_MAX;
+
+		// The new page may show the inputs in other fonts
+		for (auto& [id, input] : boundTextInputs) {
+			input.measured = false;
+		}
+		ApplyBindings();
+
+		if (hotReload) EnableHotReload();
+
+		RequestReDraw();
+		return true;
+	}
+
+	void Document::IndexElement(HTMLElement& element, bool add)
+	{
+		if (!element.attributes.Id.empty()) {
+			if (add) elementsById[element.attributes.Id] = &element;
+			else {
+				auto it = elementsById.find(element.attributes.Id);
+				if (it != elementsById.end() && it->second == &element) elementsById.erase(it);
+			}
+		}
+
+		std::istringstream ss(element.attributes.Class);
+		std::string cls;
+		while (ss >> cls) {
+			std::vector<HTMLElement*>& elements = elementsByClass[cls];
+			if (add) elements.push_back(&element);
+			else std::erase(elements, &element);
+		}
+	}
+
+	void Document::IndexChildren(HTMLElement& element)
+	{
+		IndexElement(element, true);
+
+		for (const auto& child : element.children) {
+			IndexChildren(*child);
+		}
+	}
+
+	void Document::IndexElements()
+	{
+		elementsById.clear();
+		elementsByClass.clear();
+
+		if (root) IndexChildren(*root);
+	}
+
+	// Bound values win over the page's own text whenever the elements are recreated
+	void Document::ApplyBindings()
+	{
+		for (const auto& [id, value] : boundValues) {
+			SetText(GetElementById(id), value->ToText());
+		}
+	}
+
+	TextElement Document::CreateTextElement(const HTMLElement& node, glm::vec2 offset)
+	{
+		const CSSProperties& properties = node.properties();
+
+		TextElement text;
+		text.position = properties.position + glm::vec2(0.0f, properties.fontSize) + offset;
+		text.text = node.content;
+		text.color = unpackColor(properties.color);
+		text.fontSize = properties.fontSize;
+		text.font = atomName(properties.fontFamily);
+		return text;
+	}
+
+	// Placed like text, relative to the closest div. CSS wins over the width and height attributes,
+	// an axis set by neither scales with the other one, both unset use the image's own size
+	ImageElement Document::CreateImageElement(const HTMLElement& node, glm::vec2 offset)
+	{
+		const CSSProperties& properties = node.properties();
+
+		auto attribute = [&node](const std::string& name) {
+			auto it = node.attributes.other.find(name);
+			return it == node.attributes.other.end() ? 0.0f : std::max(std::strtof(it->second.c_str(), nullptr), 0.0f);
+		};
+		glm::vec2 size;
+		size.x = properties.has(CSSProperties::Width) ? properties.size.x : attribute("width");
+		size.y = properties.has(CSSProperties::Height) ? properties.size.y : attribute("height");
+
+		ImageElement image;
+		image.position = properties.position + offset;
+		image.size = size;
+		image.image = ImageCache::NoImage;
+
+		auto src = node.attributes.other.find("src");
+		if (src == node.attributes.other.end() || src->second.empty()) return image;
+
+		fs::path path = src->second;
+		if (path.is_relative() && !baseDirectory.empty()) path = baseDirectory / path;
+		image.src = path.lexically_normal().string();
+		// Requested at the size that was set, not the one worked out below, so the request doesn't change once the file is read
+		image.image = ImageCache::Request(image.src, glm::ivec2(size));
+
+		glm::vec2 natural = glm::vec2(ImageCache::GetNaturalSize(image.image));
+		if (natural.x > 0.0f && natural.y > 0.0f) {
+			if (size.x <= 0.0f && size.y <= 0.0f) image.size = natural;
+			else if (size.x <= 0.0f) image.size.x = natural.x * size.y / natural.y;
+			else if (size.y <= 0.0f) image.size.y = natural.y * size.x / natural.x;
+		}
+		return image;
+	}
+
+	void Document::CreateElements(const std::shared_ptr<HTMLElement>& node)
+	{
+		if (!node) return;
+
+		node->renderIndex = -1;
+		node->imageIndex = -1;
+
+		if (node->tagName == "div") {
+			Div div;
+			div.position = node->properties().position;
+			div.size = {};
+			displayStack.push(div);
+		}
+		else if (node->tagName == "p") {
+			node->renderIndex = static_cast<int>(textElements.size());
+			textElements.push_back(CreateTextElement(*node, displayStack.empty() ? glm::vec2(0.0f) : displayStack.top().position));
+			renderedNodes.push_back(node.get());
+			PlaceBox(node->renderIndex);
+		}
+		else if (node->tagName == "img") {
+			node->imageIndex = static_cast<int>(imageElements.size());
+			imageElements.push_back(CreateImageElement(*node, displayStack.empty() ? glm::vec2(0.0f) : displayStack.top().position));
+			imageNodes.push_back(node.get());
+		}
+
+		// Recursively print children
+		for (const auto& child : node->children) {
+			CreateElements(child);
+		}
+
+		if (node->tagName == "div") {
+			if (!displayStack.empty()) displayStack.pop();
+		}
+	}
+
+	void Document::RebuildElements()
+	{
+		textElements.clear();
+		renderedNodes.clear();
+		imageElements.clear();
+		imageNodes.clear();
+		boxes.Clear();
+		backgroundsDirty = true;
+		hoveredElement = nullptr;
+		displayStack = {};
+
+		CreateElements(root);
+		IndexElements();
+		ApplyBindings();
+
+		RequestReDraw();
+	}
+
+	// Walks the live and reloaded trees side by side and copies over whatever changed,
+	// only touching the text elements whose values are actually different.
+	// Returns false if the structure changed and the elements have to be recreated
+	bool Document::PatchNode(HTMLElement& live, const HTMLElement& fresh, glm::vec2 offset, size_t& patches)
+	{
+		if (!(live.attributes == fresh.attributes)) {
+			live.attributes = fresh.attributes;
+			++patches;
+		}
+		if (!(live.properties() == fresh.properties())) {
+			live.style = fresh.style;
+			++patches;
+		}
+		if (live.inlineStyle != fresh.inlineStyle) {
+			live.inlineStyle = fresh.inlineStyle;
+			++patches;
+		}
+		if (live.content != fresh.content) {
+			live.content = fresh.content;
+			++patches;
+		}
+
+		if (live.tagName == "div") {
+			offset = live.properties().position;
+		}
+		else if (live.tagName == "p" && live.renderIndex >= 0) {
+			TextElement text = CreateTextElement(live, offset);
+			if (!(textElements[live.renderIndex] == text)) {
+				textElements[live.renderIndex] = std::move(text);
+				PlaceBox(live.renderIndex);
+				++patches;
+			}
+		}
+		else if (live.tagName == "img" && live.imageIndex >= 0) {
+			ImageElement image = CreateImageElement(live, offset);
+			if (!(imageElements[live.imageIndex] == image)) {
+				imageElements[live.imageIndex] = std::move(image);
+				backgroundsDirty = true;
+				++patches;
+			}
+		}
+
+		bool sameStructure = live.children.size() == fresh.children.size();
+		for (size_t i = 0; sameStructure && i < live.children.size(); ++i) {
+			sameStructure = live.children[i]->tagName == fresh.children[i]->tagName;
+		}
+
+		if (!sameStructure) {
+			live.children = fresh.children;
+			for (const auto& child : live.children) {
+				child->parent = &live;
+			}
+			++patches;
+			return false;
+		}
+
+		bool patched = true;
+		for (size_t i = 0; i < live.children.size(); ++i) {
+			patched = PatchNode(*live.children[i], *fresh.children[i], offset, patches) && patched;
+		}
+		return patched;
+	}
+
+	void Document::PatchPage(const std::shared_ptr<HTMLElement>& reloaded, const std::vector<CSSRule>& reloadedStyleSheet)
+	{
+		styleSheet = reloadedStyleSheet;
+		styleCache.Clear();
+
+		if (!root) {
+			LoadPage(reloaded);
+			return;
+		}
+
+		// Pending changes point into the live tree, which may lose nodes here
+		FlushUpdates();
+
+		auto start = std::chrono::steady_clock::now();
+
+		size_t patches = 0;
+		if (!PatchNode(*root, *reloaded, glm::vec2(0.0f), patches)) {
+			RebuildElements();
+		}
+		else {
+			IndexElements();
+			ApplyBindings();
+		}
+
+		++reloadStats.reloads;
+		reloadStats.lastChanges = patches;
+		reloadStats.lastMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		if (patches > 0) {
+			backgroundsDirty = true;
+			RequestReDraw();
+		}
+	}
+
+	void Document::EnableHotReload(bool enable)
+	{
+		hotReload = enable;
+		if (!enable) {
+			watcher.Stop();
+			return;
+		}
+
+		// Starts watching once a page is loaded from a file
+		if (htmlPath.empty()) {
+			watcher.Stop();
+			return;
+		}
+
+		// Parsing happens on the watcher thread, only the patching is posted to the document
+		watcher.Watch({ htmlPath, cssPath }, [this, html = htmlPath, css = cssPath]() {
+			auto files = OpenFiles(html, css);
+			std::vector<CSSRule> rules = parseCSS(files.second);
+
+			std::shared_ptr<HTMLElement> reloaded = ParseHTML(files.first);
+			processCSS(reloaded, rules);
+
+			// A newer reload replaces one that wasn't picked up yet
+			Post([reloaded, rules](Document& document) { document.PatchPage(reloaded, rules); }, &watcher);
+		});
+	}
+
+	void Document::Update()
+	{
+		ApplyCommands();
+
+		SyncInputs();
+		if (updateDepth == 0) FlushUpdates();
+		TrimStyleCache();
+
+		UpdateLists();
+		UpdateImages();
+
+		if (backgroundsDirty) {
+			BuildBackgrounds();
+			RequestReDraw();
+		}
+	}
+
+	void Document::Draw()
+	{
+		// Backgrounds of the whole page go first in one batch, then images and the text on top, as in css painting order
+		BoxRenderer::Draw(backgrounds, viewportSize);
+		bool imagesWaiting = DrawImages();
+
+		// Only the elements the grid finds in the viewport are drawn, the query is redone when something moved
+		if (boxes.Version() != visibleVersion || viewportSize != visibleViewport) {
+			visibleElements.clear();
+			boxes.QueryRect(Div{ glm::vec2(0.0f), viewportSize }, visibleElements);
+			visibleVersion = boxes.Version();
+			visibleViewport = viewportSize;
+		}
+
+		for (uint32_t index : visibleElements) {
+			const TextElement& text = textElements[index];
+			Text::setActiveFont(text.font);
+			Text::RenderText(text.text, viewportSize, text.position, text.fontSize, text.color);
+		}
+
+		for (const auto& [id, list] : lists) {
+			list.Draw(viewportSize);
+		}
+
+		DrawCaret();
+
+		// Decodes left for the next frame
+		shouldRedraw = imagesWaiting;
+	}
+
+	void Document::RequestReDraw()
+	{
+		shouldRedraw = true;
+	}
+
+	void Document::PlaceBox(int renderIndex)
+	{
+		const TextElement& text = textElements[renderIndex];
+
+		// Empty elements still get a box so inputs can be clicked into
+		float width = text.fontSize;
+		if (!text.text.empty()) {
+			width = Text::HasFont(text.font) ? Text::MeasureTextWidth(text.text, text.font, text.fontSize) : text.text.size() * text.fontSize * 0.5f;
+		}
+		PlaceBox(renderIndex, width);
+	}
+
+	void Document::PlaceBox(int renderIndex, float width)
+	{
+		const TextElement& text = textElements[renderIndex];
+
+		// position is the baseline, the box reaches one font size above it and a quarter below for descenders
+		Div box;
+		box.position = text.position - glm::vec2(0.0f, text.fontSize);
+		box.size = glm::vec2(width, text.fontSize * 1.25f);
+		boxes.Insert(static_cast<uint32_t>(renderIndex), box);
+
+		// Backgrounds without a set size wrap their text
+		backgroundsDirty = true;
+	}
+
+	void Document::BuildBackgrounds()
+	{
+		backgrounds.clear();
+		backgroundsDirty = false;
+
+		Div extent;
+		if (root) CollectBackgrounds(*root, extent);
+	}
+
+	// Adds the node's background before those of its children so they paint over it.
+	// A box with width and height set starts at the node's position, otherwise it wraps the node's text and
+	// everything inside it, grown by the padding. Returns false if the node and its children cover nothing
+	bool Document::CollectBackgrounds(const HTMLElement& node, Div& extent)
+	{
+		const CSSProperties& properties = node.properties();
+		// The presence bits are on the hot line, the border itself is only read if one was given
+		bool visible = (properties.background & 0xFF) != 0 || (properties.has(CSSProperties::Border) && properties.cold.borderWidth > 0.0f);
+
+		size_t slot = backgrounds.size();
+		if (visible) backgrounds.emplace_back();
+
+		bool hasContent = false;
+		auto include = [&](const Div& box) {
+			if (!hasContent) {
+				extent = box;
+				hasContent = true;
+				return;
+			}
+			glm::vec2 low = glm::min(extent.position, box.position);
+			glm::vec2 high = glm::max(extent.position + extent.size, box.position + box.size);
+			extent = Div{ low, high - low };
+		};
+
+		if (node.renderIndex >= 0) {
+			if (const Div* box = boxes.GetBox(static_cast<uint32_t>(node.renderIndex))) include(*box);
+		}
+		if (node.imageIndex >= 0) {
+			const ImageElement& image = imageElements[node.imageIndex];
+			if (image.size.x > 0.0f && image.size.y > 0.0f) include(Div{ image.position, image.size });
+		}
+		for (const auto& child : node.children) {
+			Div childExtent;
+			if (CollectBackgrounds(*child, childExtent)) include(childExtent);
+		}
+
+		if (!visible) return hasContent;
+
+		Div rect;
+		if (properties.has(CSSProperties::Width) && properties.has(CSSProperties::Height)) {
+			rect.position = properties.position + (node.tagName == "div" ? glm::vec2(0.0f) : LayoutOffset(node));
+			rect.size = properties.size;
+		}
+		else if (hasContent) {
+			const CSSEdges& padding = properties.cold.padding;
+			rect.position = extent.position - glm::vec2(padding.left, padding.top);
+			rect.size = extent.size + glm::vec2(padding.left + padding.right, padding.top + padding.bottom);
+		}
+		else {
+			// Nothing to wrap and no size of its own
+			backgrounds.erase(backgrounds.begin() + slot);
+			return false;
+		}
+
+		BoxRenderer::Box& box = backgrounds[slot];
+		box.position = rect.position;
+		box.size = rect.size;
+		box.color = unpackColor(properties.background);
+		box.borderColor = unpackColor(properties.cold.borderColor);
+		box.borderWidth = properties.cold.borderWidth;
+		box.radius = properties.cold.borderRadius;
+
+		include(rect);
+		return true;
+	}
+
+	HTMLElement* Document::HitTest(glm::vec2 point) const
+	{
+		uint32_t index = boxes.QueryPoint(point);
+		return index == SpatialGrid::NoBox ? nullptr : renderedNodes[index];
+	}
+
+	std::vector<HTMLElement*> Document::QueryRect(glm::vec2 position, glm::vec2 size) const
+	{
+		std::vector<uint32_t> indices;
+		boxes.QueryRect(Div{ position, size }, indices);
+
+		std::vector<HTMLElement*> elements;
+		elements.reserve(indices.size());
+		for (uint32_t index : indices) {
+			elements.push_back(renderedNodes[index]);
+		}
+		return elements;
+	}
+
+	VirtualList* Document::CreateList(const std::string& id, size_t itemCount, VirtualList::ItemSource source)
+	{
+		lists.erase(id);
+		VirtualList& list = lists.try_emplace(id, itemCount, std::move(source)).first->second;
+		if (HTMLElement* element = GetElementById(id)) PlaceList(list, *element);
+		list.Update();
+
+		RequestReDraw();
+		return &list;
+	}
+
+	VirtualList* Document::GetList(const std::string& id)
+	{
+		auto it = lists.find(id);
+		return it == lists.end() ? nullptr : &it->second;
+	}
+
+	void Document::RemoveList(const std::string& id)
+	{
+		if (lists.erase(id) > 0) RequestReDraw();
+	}
+
+	void Document::PlaceList(VirtualList& list, const HTMLElement& element)
+	{
+		const CSSProperties& properties = element.properties();
+
+		Div bounds;
+		bounds.position = properties.position + LayoutOffset(element);
+		bounds.size = properties.size;
+		if (!properties.has(CSSProperties::Width)) bounds.size.x = std::max(viewportSize.x - bounds.position.x, 0.0f);
+		if (!properties.has(CSSProperties::Height)) bounds.size.y = std::max(viewportSize.y - bounds.position.y, 0.0f);
+
+		list.SetBounds(bounds);
+		list.SetStyle(properties.has(CSSProperties::FontFamily) ? atomName(properties.fontFamily) : "Arial",
+			properties.fontSize > 0 ? static_cast<float>(properties.fontSize) : 16.0f, unpackColor(properties.color));
+	}
+
+	void Document::UpdateLists()
+	{
+		for (auto& [id, list] : lists) {
+			// Follows the element through restyles, reloads and viewport changes, and hides while it is missing
+			if (HTMLElement* element = GetElementById(id)) PlaceList(list, *element);
+			else list.SetBounds(Div{});
+
+			if (list.Update()) RequestReDraw();
+		}
+	}
+
+	void Document::UpdateImages()
+	{
+		uint64_t version = ImageCache::Version();
+		if (imageElements.empty() || version == imageVersion) return;
+		imageVersion = version;
+
+		// Something finished decoding, it may be one of ours
+		RequestReDraw();
+
+		for (size_t i = 0; i < imageElements.size(); ++i) {
+			ImageElement& image = imageElements[i];
+			if ((image.size.x > 0.0f && image.size.y > 0.0f) || image.image == ImageCache::NoImage) continue;
+
+			ImageElement sized = CreateImageElement(*imageNodes[i], LayoutOffset(*imageNodes[i]));
+			if (!(sized == image)) {
+				image = std::move(sized);
+				backgroundsDirty = true;
+			}
+		}
+	}
+
+	bool Document::DrawImages()
+	{
+		// Every document uploads what finished, whichever draws first
+		bool waiting = ImageCache::Upload();
+		if (imageElements.empty()) return false;
+
+		imageBatch.clear();
+		imagePlaceholders.clear();
+		for (const ImageElement& image : imageElements) {
+			if (image.size.x <= 0.0f || image.size.y <= 0.0f) continue;
+
+			// Off screen images aren't marked as drawn, so they are the first to go when the cache is full
+			glm::vec2 high = image.position + image.size;
+			if (high.x <= 0.0f || high.y <= 0.0f || image.position.x >= viewportSize.x || image.position.y >= viewportSize.y) continue;
+
+			GLuint texture = image.image == ImageCache::NoImage ? 0 : ImageCache::GetTexture(image.image);
+			if (texture) {
+				imageBatch.push_back({ texture, image.position, image.size });
+				continue;
+			}
+
+			BoxRenderer::Box placeholder;
+			placeholder.position = image.position;
+			placeholder.size = image.size;
+			placeholder.color = glm::vec4(0.5f, 0.5f, 0.5f, 0.25f);
+			imagePlaceholders.push_back(placeholder);
+		}
+
+		BoxRenderer::Draw(imagePlaceholders, viewportSize);
+		ImageRenderer::Draw(imageBatch, viewportSize);
+		return waiting;
+	}
+
+	void Document::PostText(const std::string& id, const std::string& text)
+	{
+		PostCommand({ Command::SetText, id, "", text });
+	}
+
+	void Document::PostAttribute(const std::string& id, const std::string& name, const std::string& value)
+	{
+		PostCommand({ Command::SetAttribute, id, name, value });
+	}
+
+	void Document::PostStyle(const std::string& id, const std::string& property, const std::string& value)
+	{
+		PostCommand({ Command::SetStyle, id, property, value });
+	}
+
+	void Document::PostClass(const std::string& id, const std::string& className, bool add)
+	{
+		PostCommand({ add ? Command::AddClass : Command::RemoveClass, id, className });
+	}
+
+	void Document::Post(std::function<void(Document&)> call, const void* target)
+	{
+		Command command;
+		command.target = target;
+		command.call = std::move(call);
+		PostCommand(std::move(command));
+	}
+
+	void Document::SetWakeCallback(std::function<void()> wake)
+	{
+		wakeCallback = std::move(wake);
+	}
+
+	void Document::PostCommand(Command command)
+	{
+		// Only the first command of a frame needs to wake the loop, the rest are picked up with it
+		if (commands.Push(std::move(command)) && wakeCallback) wakeCallback();
+	}
+
+	void Document::ApplyCommands()
+	{
+		if (commands.Empty()) return;
+
+		// Everything posted since the last frame is applied as one batch
+		BeginUpdate();
+		for (Command& command : commands.Drain()) {
+			switch (command.kind) {
+			case Command::SetText:
+				SetText(GetElementById(command.id), command.value);
+				break;
+			case Command::SetAttribute:
+				SetAttribute(GetElementById(command.id), command.name, command.value);
+				break;
+			case Command::SetStyle:
+				SetStyle(GetElementById(command.id), command.name, command.value);
+				break;
+			case Command::AddClass:
+				AddClass(GetElementById(command.id), command.name);
+				break;
+			case Command::RemoveClass:
+				RemoveClass(GetElementById(command.id), command.name);
+				break;
+			case Command::Call:
+				if (command.call) command.call(*this);
+				break;
+			}
+		}
+		EndUpdate();
+	}
+
+	bool Document::IsBound(const Binding::Observable* value) const
+	{
+		for (const auto& [id, bound] : boundValues) {
+			if (bound == value) return true;
+		}
+		return false;
+	}
+
+	void Document::SetViewportSize(glm::vec2 size)
+	{
+		if (viewportSize == size) return;
+
+		viewportSize = size;
+		RequestReDraw();
+	}
+
+	void Document::SetFocus(const std::string& id)
+	{
+		if (currentFocusInputID == id) return;
+
+		currentFocusInputID = id;
+		RequestReDraw();
+	}
+
+
+	glm::vec2 Document::LayoutOffset(const HTMLElement& element)
+	{
+		// Text is placed relative to the closest enclosing div
+		for (const HTMLElement* parent = element.parent; parent; parent = parent->parent) {
+			if (parent->tagName == "div") return parent->properties().position;
+		}
+		return glm::vec2(0.0f);
+	}
+
+	void Document::RelayoutElement(HTMLElement& element)
+	{
+		if (element.renderIndex >= 0) {
+			textElements[element.renderIndex] = CreateTextElement(element, LayoutOffset(element));
+			PlaceBox(element.renderIndex);
+		}
+		if (element.imageIndex >= 0) {
+			imageElements[element.imageIndex] = CreateImageElement(element, LayoutOffset(element));
+		}
+
+		for (const auto& child : element.children) {
+			RelayoutElement(*child);
+		}
+	}
+
+	void Document::MarkDirty(HTMLElement* element, unsigned char flags)
+	{
+		if (element->dirty == HTMLElement::Clean) dirtyElements.push_back(element);
+		element->dirty |= flags;
+	}
+
+	HTMLElement* Document::GetElementById(const std::string& id)
+	{
+		auto it = elementsById.find(id);
+		return it == elementsById.end() ? nullptr : it->second;
+	}
+
+	std::vector<HTMLElement*> Document::GetElementsByClassName(const std::string& className)
+	{
+		auto it = elementsByClass.find(className);
+		return it == elementsByClass.end() ? std::vector<HTMLElement*>() : it->second;
+	}
+
+	void Document::SetText(HTMLElement* element, const std::string& text)
+	{
+		if (!element || element->content == text) return;
+
+		element->content = text;
+		MarkDirty(element, HTMLElement::DirtyLayout);
+	}
+
+	void Document::SetAttribute(HTMLElement* element, const std::string& name, const std::string& value)
+	{
+		if (!element) return;
+
+		if (name == "id" || name == "class") {
+			std::string& attribute = (name == "id") ? element->attributes.Id : element->attributes.Class;
+			if (attribute == value) return;
+
+			IndexElement(*element, false);
+			attribute = value;
+			IndexElement(*element, true);
+
+			MarkDirty(element, HTMLElement::DirtyStyle);
+		}
+		else if (name == "style") {
+			element->inlineStyle = parseDeclarations(value);
+			MarkDirty(element, HTMLElement::DirtyStyle);
+		}
+		else {
+			element->attributes.other[name] = value;
+			// Images are requested again at the new size or source
+			if (element->imageIndex >= 0 && (name == "src" || name == "width" || name == "height")) MarkDirty(element, HTMLElement::DirtyLayout);
+		}
+	}
+
+	void Document::AddClass(HTMLElement* element, const std::string& className)
+	{
+		if (!element) return;
+
+		std::istringstream ss(element->attributes.Class);
+		std::string cls;
+		while (ss >> cls) {
+			if (cls == className) return;
+		}
+
+		SetAttribute(element, "class", element->attributes.Class.empty() ? className : element->attributes.Class + " " + className);
+	}
+
+	void Document::RemoveClass(HTMLElement* element, const std::string& className)
+	{
+		if (!element) return;
+
+		std::istringstream ss(element->attributes.Class);
+		std::string cls, classes;
+		while (ss >> cls) {
+			if (cls == className) continue;
+			if (!classes.empty()) classes += " ";
+			classes += cls;
+		}
+
+		SetAttribute(element, "class", classes);
+	}
+
+	void Document::SetStyle(HTMLElement* element, const std::string& property, const std::string& value)
+	{
+		if (!element) return;
+
+		auto it = element->inlineStyle.find(property);
+		if (it != element->inlineStyle.end() && it->second == value) return;
+
+		element->inlineStyle[property] = value;
+		MarkDirty(element, HTMLElement::DirtyStyle);
+	}
+
+	void Document::BeginUpdate()
+	{
+		++updateDepth;
+	}
+
+	void Document::EndUpdate()
+	{
+		if (updateDepth > 0) --updateDepth;
+	}
+
+	void Document::FlushUpdates()
+	{
+		if (dirtyElements.empty()) return;
+
+		// With rules that look at ancestors, a changed id or class can restyle the elements inside even if the
+		// element's own style stays the same
+		bool ancestorRules = hasCombinators(styleSheet);
+
+		for (HTMLElement* element : dirtyElements) {
+			bool restyled = false;
+			if (element->dirty & HTMLElement::DirtyStyle) {
+				std::shared_ptr<const CSSProperties> previous = element->style;
+				restyleNode(*element, styleSheet, styleCache);
+				restyled = element->style != previous && !(previous && *previous == *element->style);
+				if (ancestorRules && element->style != previous) restyled = true;
+
+				// Everything inside may inherit from the new style
+				if (restyled) {
+					for (const auto& child : element->children) {
+						processCSS(*child, styleSheet, styleCache);
+					}
+				}
+			}
+
+			// A restyled div can move everything inside it
+			if (restyled) RelayoutElement(*element);
+			else if ((element->dirty & HTMLElement::DirtyLayout) && element->renderIndex >= 0) {
+				textElements[element->renderIndex] = CreateTextElement(*element, LayoutOffset(*element));
+				PlaceBox(element->renderIndex);
+			}
+			else if ((element->dirty & HTMLElement::DirtyLayout) && element->imageIndex >= 0) {
+				imageElements[element->imageIndex] = CreateImageElement(*element, LayoutOffset(*element));
+			}
+
+			element->dirty = HTMLElement::Clean;
+		}
+		dirtyElements.clear();
+		backgroundsDirty = true;
+
+		RequestReDraw();
+	}
+
+	void Document::Bind(const std::string& id, Binding::Observable& value)
+	{
+		Unbind(id);
+
+		value.AddBinding(*this, id);
+		boundValues[id] = &value;
+
+		SetText(GetElementById(id), value.ToText());
+	}
+
+	void Document::BindInput(const std::string& id, Bindable<std::string>& value)
+	{
+		Bind(id, value);
+
+		TextInput& input = boundTextInputs[id];
+		input.value = &value;
+		input.buffer.setText(value.Get());
+		input.buffer.takeDirtyRange();
+		input.syncedVersion = value.Version();
+	}
+
+	void Document::Unbind(const std::string& id)
+	{
+		auto it = boundValues.find(id);
+		if (it == boundValues.end()) return;
+
+		it->second->RemoveBinding(*this, id);
+		boundValues.erase(it);
+		boundTextInputs.erase(id);
+		std::erase(editedInputs, id);
+	}
+
+	Document::TextInput* Document::FocusedInput()
+	{
+		auto it = boundTextInputs.find(currentFocusInputID);
+		if (it == boundTextInputs.end()) return nullptr;
+
+		// The application changed the value since we last synced, start over from its text
+		TextInput& input = it->second;
+		if (input.value->Version() != input.syncedVersion) ResetInput(input);
+		return &input;
+	}
+
+	void Document::ResetInput(TextInput& input)
+	{
+		input.buffer.setText(input.value->Get());
+		input.buffer.takeDirtyRange();
+		input.syncedVersion = input.value->Version();
+		input.measured = false;
+	}
+
+	void Document::InputEdited(TextInput& input)
+	{
+		if (!input.edited) {
+			input.edited = true;
+			editedInputs.push_back(currentFocusInputID);
+		}
+		RequestReDraw();
+	}
+
+	void Document::SyncInputs()
+	{
+		// Keystrokes only touch the gap buffers, the bound values catch up once per frame
+		for (const std::string& id : editedInputs) {
+			TextInput& input = boundTextInputs[id];
+			input.edited = false;
+
+			// The value was set since the keystrokes (a posted command or a key handler), it wins over them.
+			// The dirty range is relative to the old value, so it is dropped rather than applied
+			if (input.value->Version() != input.syncedVersion) {
+				ResetInput(input);
+				SetText(GetElementById(id), input.value->Get());
+				continue;
+			}
+
+			// Outside the dirty range the old and new texts are the same, so only that span is replaced everywhere
+			Text::GapBuffer::Range range = input.buffer.takeDirtyRange();
+			size_t oldSize = input.value->Get().size();
+			size_t removed = range.end - range.begin + oldSize - input.buffer.size();
+			std::string inserted = input.buffer.substr(range.begin, range.end);
+
+			EditInput(input, range.begin, removed, inserted);
+
+			// The element is edited in place, the value's notification would copy and compare the whole text
+			HTMLElement* element = GetElementById(id);
+			uint64_t version = input.value->Version() + 1;
+			if (element) input.value->Mute(*this, id);
+			input.value->Modify([&](std::string& text) {
+				text.replace(range.begin, removed, inserted);
+			});
+			input.value->Unmute();
+
+			if (input.value->Version() == version) {
+				if (element) EditInputElement(*element, input, range.begin, removed, inserted, oldSize);
+			}
+			else {
+				// A listener changed the value again, the element and, once focused, the buffer take it whole
+				SetText(element, input.value->Get());
+			}
+			input.syncedVersion = version;
+		}
+		editedInputs.clear();
+	}
+
+	static float sumAdvances(const std::vector<float>& advances, size_t begin, size_t end)
+	{
+		float sum = 0.0f;
+		for (size_t i = begin; i < end; ++i) sum += advances[i];
+		return sum;
+	}
+
+	void Document::MeasureInput(TextInput& input, const TextElement& text)
+	{
+		if (input.measured && input.measuredFont == text.font && input.measuredSize == text.fontSize && input.advances.size() == input.buffer.size()) return;
+
+		std::string whole = input.buffer.text();
+		input.advances.clear();
+		if (Text::HasFont(text.font)) Text::MeasureAdvances(whole, text.font, text.fontSize, input.advances);
+		else input.advances.assign(whole.size(), text.fontSize * 0.5f); // as PlaceBox guesses without the font
+
+		input.width = sumAdvances(input.advances, 0, input.advances.size());
+		input.measuredFont = text.font;
+		input.measuredSize = text.fontSize;
+		input.measured = true;
+		input.caretByte = 0;
+		input.caretOffset = 0.0f;
+	}
+
+	void Document::EditInput(TextInput& input, size_t begin, size_t removed, std::string_view inserted)
+	{
+		if (!input.measured) return;
+
+		std::vector<float> added;
+		if (Text::HasFont(input.measuredFont)) Text::MeasureAdvances(inserted, input.measuredFont, input.measuredSize, added);
+		else added.assign(inserted.size(), input.measuredSize * 0.5f);
+		float addedWidth = sumAdvances(added, 0, added.size());
+		float removedWidth = sumAdvances(input.advances, begin, begin + removed);
+
+		// A caret past the edit keeps its distance to the text after it, one inside the removed bytes ends up at its start
+		if (input.caretByte > begin) {
+			size_t removedEnd = begin + removed;
+			if (input.caretByte >= removedEnd) {
+				input.caretOffset += addedWidth - removedWidth;
+				input.caretByte = input.caretByte - removed + inserted.size();
+			}
+			else {
+				input.caretOffset -= sumAdvances(input.advances, begin, input.caretByte);
+				input.caretByte = begin;
+			}
+		}
+
+		input.advances.erase(input.advances.begin() + begin, input.advances.begin() + begin + removed);
+		input.advances.insert(input.advances.begin() + begin, added.begin(), added.end());
+		input.width += addedWidth - removedWidth;
+	}
+
+	void Document::EditInputElement(HTMLElement& element, TextInput& input, size_t begin, size_t removed, std::string_view inserted, size_t oldSize)
+	{
+		if (element.content.size() != oldSize) {
+			SetText(&element, input.value->Get());
+			return;
+		}
+		element.content.replace(begin, removed, inserted);
+
+		// Pending restyles and relayouts rebuild the text element from the content anyway
+		if (element.renderIndex < 0 || element.dirty != HTMLElement::Clean) return;
+
+		TextElement& text = textElements[element.renderIndex];
+		if (text.text.size() != oldSize) {
+			MarkDirty(&element, HTMLElement::DirtyLayout);
+			return;
+		}
+		text.text.replace(begin, removed, inserted);
+
+		MeasureInput(input, text);
+		PlaceBox(element.renderIndex, text.text.empty() ? text.fontSize : input.width);
+		RequestReDraw();
+	}
+
+	void Document::DrawCaret()
+	{
+		auto input = boundTextInputs.find(currentFocusInputID);
+		HTMLElement* element = GetElementById(currentFocusInputID);
+		if (input == boundTextInputs.end() || !element || element->renderIndex < 0) return;
+
+		const TextElement& text = textElements[element->renderIndex];
+		if (text.font.empty()) return;
+
+		// Edits not synced yet leave the caret where it was for this frame.
+		// Otherwise only the advances between its last and current position are added up
+		TextInput& edited = input->second;
+		if (!edited.buffer.isDirty()) {
+			MeasureInput(edited, text);
+
+			size_t cursor = edited.buffer.cursor();
+			if (cursor >= edited.caretByte) edited.caretOffset += sumAdvances(edited.advances, edited.caretByte, cursor);
+			else edited.caretOffset -= sumAdvances(edited.advances, cursor, edited.caretByte);
+			edited.caretByte = cursor;
+			// Snaps back to exact values at the ends, so moving back and forth doesn't drift
+			if (cursor == 0) edited.caretOffset = 0.0f;
+			else if (cursor == edited.advances.size()) edited.caretOffset = edited.width;
+		}
+
+		Text::setActiveFont(text.font);
+		Text::RenderText("|", viewportSize, text.position + glm::vec2(edited.caretOffset, 0.0f), text.fontSize, text.color);
+	}
+
+	void Document::TrimStyleCache()
+	{
+		uint64_t limit = MemoryStats::GetLimits().styleCacheEntries;
+		if (limit > 0 && styleCache.Size() > limit) styleCache.Clear();
+	}
+
+	void Document::CountNode(const HTMLElement& node, MemoryStats::DocumentUsage& usage, std::unordered_set<const CSSProperties*>& styles)
+	{
+		++usage.dom.count;
+		usage.dom.bytes += sizeof(HTMLElement) + MemoryStats::SharedBlockBytes;
+		usage.dom.bytes += MemoryStats::StringBytes(node.tagName) + MemoryStats::StringBytes(node.content);
+		usage.dom.bytes += MemoryStats::StringBytes(node.attributes.Class) + MemoryStats::StringBytes(node.attributes.Id);
+		usage.dom.bytes += MemoryStats::MapBytes(node.attributes.other) + MemoryStats::MapBytes(node.inlineStyle);
+		usage.dom.bytes += MemoryStats::VectorBytes(node.children);
+
+		// Shared styles are counted once
+		if (node.style && styles.insert(node.style.get()).second) {
+			++usage.styles.count;
+			usage.styles.bytes += sizeof(CSSProperties) + MemoryStats::SharedBlockBytes;
+		}
+
+		for (const auto& child : node.children) CountNode(*child, usage, styles);
+	}
+
+	MemoryStats::DocumentUsage Document::GetMemoryUsage() const
+	{
+		MemoryStats::DocumentUsage usage;
+
+		std::unordered_set<const CSSProperties*> styles;
+		if (root) CountNode(*root, usage, styles);
+
+		usage.styles.bytes += MemoryStats::VectorBytes(styleSheet);
+		for (const CSSRule& rule : styleSheet) {
+			usage.styles.bytes += MemoryStats::StringBytes(rule.selector) + MemoryStats::MapBytes(rule.properties);
+		}
+		usage.styleCache = styleCache.GetMemoryUsage();
+
+		usage.textElements = { textElements.size(), MemoryStats::VectorBytes(textElements) };
+		for (const TextElement& element : textElements) {
+			usage.textElements.bytes += MemoryStats::StringBytes(element.text) + MemoryStats::StringBytes(element.font);
+		}
+		usage.layout.bytes += MemoryStats::HashMapBytes(lists);
+		for (const auto& [id, list] : lists) {
+			usage.textElements += list.GetMemoryUsage();
+			usage.layout.bytes += MemoryStats::StringBytes(id);
+		}
+
+		usage.images = { imageElements.size(), MemoryStats::VectorBytes(imageElements) + MemoryStats::VectorBytes(imageNodes) };
+		usage.images.bytes += MemoryStats::VectorBytes(imageBatch) + MemoryStats::VectorBytes(imagePlaceholders);
+		for (const ImageElement& image : imageElements) usage.images.bytes += MemoryStats::StringBytes(image.src);
+
+		usage.layout.count = boxes.Size();
+		usage.layout.bytes += boxes.MemoryBytes() + MemoryStats::VectorBytes(visibleElements) + MemoryStats::VectorBytes(renderedNodes);
+		usage.layout.bytes += MemoryStats::VectorBytes(backgrounds) + MemoryStats::VectorBytes(dirtyElements);
+		usage.layout.bytes += MemoryStats::HashMapBytes(elementsById) + MemoryStats::HashMapBytes(elementsByClass);
+		for (const auto& [id, element] : elementsById) usage.layout.bytes += MemoryStats::StringBytes(id);
+		for (const auto& [className, elements] : elementsByClass) {
+			usage.layout.bytes += MemoryStats::StringBytes(className) + MemoryStats::VectorBytes(elements);
+		}
+
+		return usage;
+	}
+
+	void Document::PrintMemoryStats(std::ostream& out) const
+	{
+		MemoryStats::PrintStats(GetMemoryUsage(), MemoryStats::GetSharedUsage(), out);
+	}
+
+	void Document::OnChar(unsigned int codepoint)
+	{
+		TextInput* input = FocusedInput();
+		if (!input || codepoint == 0) return;
+
+		input->buffer.insert(Text::EncodeUTF8(codepoint));
+		InputEdited(*input);
+	}
+
+	void Document::OnKey(int key, int action, int mods)
+	{
+		RequestReDraw();
+
+		TextInput* input = FocusedInput();
+		if (!input) return;
+
+		if (action == GLFW_PRESS || action == GLFW_REPEAT) {
+			Text::GapBuffer& buffer = input->buffer;
+			bool select = mods & GLFW_MOD_SHIFT;
+
+			switch (key) {
+			case GLFW_KEY_BACKSPACE:
+				buffer.eraseBackward();
+				InputEdited(*input);
+				break;
+			case GLFW_KEY_DELETE:
+				buffer.eraseForward();
+				InputEdited(*input);
+				break;
+			case GLFW_KEY_TAB:
+				buffer.insert("    ");
+				InputEdited(*input);
+				break;
+			case GLFW_KEY_LEFT:
+				buffer.moveLeft(select);
+				break;
+			case GLFW_KEY_RIGHT:
+				buffer.moveRight(select);
+				break;
+			case GLFW_KEY_HOME:
+				buffer.moveHome(select);
+				break;
+			case GLFW_KEY_END:
+				buffer.moveEnd(select);
+				break;
+			case GLFW_KEY_A:
+				if (mods & GLFW_MOD_CONTROL) buffer.selectAll();
+				break;
+			}
+		}
+	}
+
+	void Document::OnScroll(glm::vec2 cursor, float offset)
+	{
+		for (auto& [id, list] : lists) {
+			if (!list.Contains(cursor)) continue;
+
+			// Three rows per wheel step, wheel up scrolls towards the start
+			list.ScrollBy(-offset * 3.0 * list.GetRowHeight());
+			return;
+		}
+	}
+
+	void Document::OnMouseMove(glm::vec2 cursor)
+	{
+		hoveredElement = HitTest(cursor);
+	}
+
+	void Document::OnMouseButton(glm::vec2 cursor, int button, int action)
+	{
+		if (button != GLFW_MOUSE_BUTTON_LEFT || action != GLFW_PRESS) return;
+
+		// Clicking a bound input focuses it, clicking anywhere else drops the focus
+		HTMLElement* element = HitTest(cursor);
+		if (element && boundTextInputs.count(element->attributes.Id)) SetFocus(element->attributes.Id);
+		else SetFocus("");
+	}
+}
@@ -0,0 +1,307 @@
+#pragma once
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <stack>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "../Elements.hpp"
+#include "../Text/Text.hpp"
+#include "../Text/GapBuffer.hpp"
+#include "../Parser/Parser.hpp"
+#include "../Watcher/Watcher.hpp"
+#include "../Binding/Binding.hpp"
+#include "../Renderer/BoxRenderer.hpp"
+#include "../Renderer/ImageRenderer.hpp"
+#include "../Image/ImageCache.hpp"
+#include "../Memory/MemoryStats.hpp"
+#include "CommandQueue.hpp"
+#include "VirtualList.hpp"
+#include "SpatialGrid.hpp"
+
+namespace Lucid {
+	using namespace Parser;
+
+	// A page together with everything that belongs to it: its tree, style sheet, elements, bindings and input state.
+	// Documents are independent of each other and of the window, any number of them can live in one process.
+	// Fonts and glyphs are shared between all documents through Text.
+	// A document is not thread-safe, other threads change it through the Post functions.
+	// Different documents can be used from different threads as long as only the thread owning the GL context calls Draw
+	class Document {
+	public:
+		struct ReloadStats {
+			uint64_t reloads = 0;
+			size_t lastChanges = 0; // elements patched by the last reload
+			double lastMilliseconds = 0.0;
+		};
+
+		Document() = default;
+		Document(const Document&) = delete;
+		Document& operator=(const Document&) = delete;
+		~Document();
+
+		void LoadPage(const std::string& htmlPath, std::string CSSPath = "");
+		void LoadPage(const std::shared_ptr<HTMLElement>& node);
+		// Loads a page that is already in memory, such as an embedded resource. Hot reload has no files to watch for it.
+		// Relative image sources are looked up in baseDirectory, pages loaded from a file use the file's directory
+		void LoadPageSource(const std::string& html, const std::string& css = "", const std::filesystem::path& baseDirectory = {});
+		// Reads, parses, styles and lays out the page on a worker thread while the current page keeps running,
+		// then swaps it in at the start of an Update. A later load of either kind cancels this one.
+		// The future and onLoaded are resolved during Update with whether the page was swapped in,
+		// so don't wait on the future from the thread that calls Update. Destroying the document first resolves
+		// the future with false without calling onLoaded
+		std::future<bool> LoadPageAsync(const std::string& htmlPath, std::string CSSPath = "", std::function<void(bool)> onLoaded = {});
+		// Applies only the differences between the loaded page and the given tree
+		void PatchPage(const std::shared_ptr<HTMLElement>& reloaded, const std::vector<CSSRule>& reloadedStyleSheet);
+		// Recreates every element from the loaded page
+		void RebuildElements();
+		// Re-parses the page whenever its html or css file changes on disk and patches the changes in
+		void EnableHotReload(bool enable = true);
+
+		// Applies posted commands and input, then flushes pending changes. Doesn't need a GL context
+		void Update();
+		// Renders the elements into the current GL context
+		void Draw();
+		void RequestReDraw();
+
+		/* ---Getters--- */
+		bool NeedsReDraw() const { return shouldRedraw; }
+		const std::shared_ptr<HTMLElement>& GetRoot() const { return root; }
+		const std::vector<TextElement>& GetTextElements() const { return textElements; }
+		const std::vector<ImageElement>& GetImageElements() const { return imageElements; }
+		// Backgrounds and borders in painting order, rebuilt by Update after layout changes
+		const std::vector<BoxRenderer::Box>& GetBackgrounds() const { return backgrounds; }
+		glm::vec2 GetViewportSize() const { return viewportSize; }
+		const std::string& GetFocus() const { return currentFocusInputID; }
+		// Element under the cursor as of the last OnMouseMove, nullptr if none
+		HTMLElement* GetHovered() const { return hoveredElement; }
+		const ReloadStats& GetReloadStats() const { return reloadStats; }
+
+		/* ---Setters--- */
+		void SetViewportSize(glm::vec2 size);
+		void SetFocus(const std::string& id);
+
+		/* ---DOM--- */
+		// Returned elements stay valid until the page is loaded again or its structure is hot reloaded
+		HTMLElement* GetElementById(const std::string& id);
+		std::vector<HTMLElement*> GetElementsByClassName(const std::string& className);
+
+		// Changes are only recorded here, the affected elements are restyled and laid out by FlushUpdates
+		void SetText(HTMLElement* element, const std::string& text);
+		void SetAttribute(HTMLElement* element, const std::string& name, const std::string& value);
+		void AddClass(HTMLElement* element, const std::string& className);
+		void RemoveClass(HTMLElement* element, const std::string& className);
+		void SetStyle(HTMLElement* element, const std::string& property, const std::string& value);
+
+		// Changes made between BeginUpdate and EndUpdate are held back and flushed together
+		void BeginUpdate();
+		void EndUpdate();
+		// Applies all pending changes, Update calls this once per frame
+		void FlushUpdates();
+
+		/* ---Bindings--- */
+		// Shows the value as the text of the element with the given id, kept up to date as the value changes
+		void Bind(const std::string& id, Binding::Observable& value);
+		// Same as Bind, and typing into the element while it has focus edits the value
+		void BindInput(const std::string& id, Bindable<std::string>& value);
+		void Unbind(const std::string& id);
+
+		/* ---Hit testing--- */
+		// Topmost element whose laid out box contains the point, nullptr if there is none
+		HTMLElement* HitTest(glm::vec2 point) const;
+		// Elements whose boxes intersect the rectangle, in drawing order
+		std::vector<HTMLElement*> QueryRect(glm::vec2 position, glm::vec2 size) const;
+
+		/* ---Lists--- */
+		// Shows itemCount rows from source in place of the element with the given id, only the rows in view are materialized.
+		// The list takes the element's position, font and color, and its width and height (the rest of the viewport if unset).
+		// It stays hidden while the page has no element with that id
+		VirtualList* CreateList(const std::string& id, size_t itemCount, VirtualList::ItemSource source);
+		VirtualList* GetList(const std::string& id);
+		void RemoveList(const std::string& id);
+
+		/* ---Threads--- */
+		// These can be called from any thread and never wait for the document's thread.
+		// The changes are applied at the start of the next Update, where only the last change posted
+		// for the same element and property since the previous frame is kept
+		void PostText(const std::string& id, const std::string& text);
+		void PostAttribute(const std::string& id, const std::string& name, const std::string& value);
+		void PostStyle(const std::string& id, const std::string& property, const std::string& value);
+		void PostClass(const std::string& id, const std::string& className, bool add = true);
+		// Runs call on the document's thread, calls with the same non-null target replace each other
+		void Post(std::function<void(Document&)> call, const void* target = nullptr);
+
+		// Sets a value bound to this document on the document's thread, only the latest value posted per frame is set.
+		// Values destroyed or unbound by then are skipped
+		template<typename T>
+		void Post(Bindable<T>& bindable, T value)
+		{
+			Binding::Observable* target = &bindable;
+			Post([target, value = std::move(value)](Document& document) {
+				// Destroyed values unbind themselves, so the address is only followed while it is still bound here
+				if (!document.IsBound(target)) return;
+				if (auto* bound = dynamic_cast<Bindable<T>*>(target)) bound->Set(value);
+			}, target);
+		}
+
+		// Called from the posting thread when a command arrives in an empty queue, used to wake up the event loop.
+		// Set it before other threads start posting
+		void SetWakeCallback(std::function<void()> wake);
+
+		/* ---Memory--- */
+		// Estimated memory owned by this document, see MemoryStats::GetSharedUsage for the fonts and glyphs
+		MemoryStats::DocumentUsage GetMemoryUsage() const;
+		void PrintMemoryStats(std::ostream& out = std::cout) const;
+
+		/* ---Input--- */
+		void OnChar(unsigned int codepoint);
+		void OnKey(int key, int action, int mods);
+		void OnMouseMove(glm::vec2 cursor);
+		// Left clicks focus the input under the cursor
+		void OnMouseButton(glm::vec2 cursor, int button, int action);
+		// Scrolls the list under the cursor, offset is in wheel steps
+		void OnScroll(glm::vec2 cursor, float offset);
+
+	private:
+		struct TextInput {
+			Bindable<std::string>* value = nullptr;
+			Text::GapBuffer buffer;
+			uint64_t syncedVersion = 0; // version of the value the buffer last matched
+			bool edited = false;
+
+			// What each byte of the buffer moves the pen by, kept up to date over the edited bytes only
+			std::vector<float> advances;
+			float width = 0.0f;
+			std::string measuredFont;
+			float measuredSize = 0.0f;
+			bool measured = false;
+
+			size_t caretByte = 0;     // cursor position caretOffset was last worked out for
+			float caretOffset = 0.0f; // distance of that position from the start of the text
+		};
+
+		void IndexElement(HTMLElement& element, bool add);
+		void IndexChildren(HTMLElement& element);
+		void IndexElements();
+		void ApplyBindings();
+
+		TextElement CreateTextElement(const HTMLElement& node, glm::vec2 offset);
+		// Requests the decode, at the size set by css or the width and height attributes
+		ImageElement CreateImageElement(const HTMLElement& node, glm::vec2 offset);
+		void CreateElements(const std::shared_ptr<HTMLElement>& node);
+		bool PatchNode(HTMLElement& live, const HTMLElement& fresh, glm::vec2 offset, size_t& patches);
+
+		glm::vec2 LayoutOffset(const HTMLElement& element);
+		void RelayoutElement(HTMLElement& element);
+		void MarkDirty(HTMLElement* element, unsigned char flags);
+
+		// Keeps the spatial index in step with textElements, call whenever an element is created or changed
+		void PlaceBox(int renderIndex);
+		void PlaceBox(int renderIndex, float width);
+		void PlaceList(VirtualList& list, const HTMLElement& element);
+		void BuildBackgrounds();
+		bool CollectBackgrounds(const HTMLElement& node, Div& extent);
+		void UpdateLists();
+		// Sizes the images that take their size from the file once it is known
+		void UpdateImages();
+		// Uploads finished decodes and draws the images on screen, placeholders for those still decoding.
+		// Returns true if decodes are still waiting to be uploaded
+		bool DrawImages();
+
+		bool AdoptPage(Document& staged);
+
+		// Empties the style cache once it is past MemoryStats' limit
+		void TrimStyleCache();
+		static void CountNode(const HTMLElement& node, MemoryStats::DocumentUsage& usage, std::unordered_set<const CSSProperties*>& styles);
+
+		void PostCommand(Command command);
+		void ApplyCommands();
+		bool IsBound(const Binding::Observable* value) const;
+
+		TextInput* FocusedInput();
+		// Starts the buffer over from the bound value's text
+		void ResetInput(TextInput& input);
+		void InputEdited(TextInput& input);
+		void SyncInputs();
+		// Measures the whole buffer again if it was never measured or the element's font changed
+		void MeasureInput(TextInput& input, const TextElement& text);
+		void EditInput(TextInput& input, size_t begin, size_t removed, std::string_view inserted);
+		// Gives the element the input's edit in place, falls back to a full relayout if it isn't in step
+		void EditInputElement(HTMLElement& element, TextInput& input, size_t begin, size_t removed, std::string_view inserted, size_t oldSize);
+		void DrawCaret();
+
+		std::string htmlPath, cssPath;
+		std::shared_ptr<HTMLElement> root;
+		std::vector<CSSRule> styleSheet;
+		StyleCache styleCache;
+
+		std::unordered_map<std::string, HTMLElement*> elementsById;
+		std::unordered_map<std::string, std::vector<HTMLElement*>> elementsByClass;
+
+		std::vector<HTMLElement*> dirtyElements;
+		int updateDepth = 0;
+
+		std::stack<Div> displayStack;
+		std::vector<TextElement> textElements;
+		std::vector<HTMLElement*> renderedNodes; // node each text element was created for
+
+		std::filesystem::path baseDirectory;
+		std::vector<ImageElement> imageElements;
+		std::vector<HTMLElement*> imageNodes; // node each image element was created for
+		std::vector<ImageRenderer::Image> imageBatch;
+		std::vector<BoxRenderer::Box> imagePlaceholders;
+		uint64_t imageVersion = UINT64_MAX; // ImageCache version the images were last sized for
+
+		// Boxes of the text elements, ids are render indices
+		SpatialGrid boxes;
+		std::vector<uint32_t> visibleElements;
+		uint64_t visibleVersion = UINT64_MAX;
+		glm::vec2 visibleViewport{ -1.0f };
+		HTMLElement* hoveredElement = nullptr;
+
+		std::vector<BoxRenderer::Box> backgrounds;
+		bool backgroundsDirty = true;
+		glm::vec2 viewportSize = glm::vec2(1000.0f, 600.0f);
+		bool shouldRedraw = true;
+
+		std::unordered_map<std::string, VirtualList> lists;
+
+		std::unordered_map<std::string, Binding::Observable*> boundValues;
+		std::unordered_map<std::string, TextInput> boundTextInputs;
+		std::vector<std::string> editedInputs;
+		std::string currentFocusInputID;
+
+		CommandQueue commands;
+		std::function<void()> wakeCallback;
+
+		// Posts reloaded pages from its own thread
+		FileWatcher watcher;
+		bool hotReload = false;
+		ReloadStats reloadStats;
+
+		// Only touched on the document's thread, the worker hands it over inside the command it posts
+		struct LoadResult {
+			std::promise<bool> promise;
+			bool delivered = false;
+		};
+		struct PageLoad {
+			std::thread thread;
+			std::shared_ptr<std::atomic<bool>> finished;
+			std::shared_ptr<LoadResult> result;
+		};
+		std::vector<PageLoad> pageLoads;
+		// Bumped by every load, a background load whose generation is no longer current is cancelled
+		std::atomic<uint64_t> loadGeneration = 0;
+	};
+}
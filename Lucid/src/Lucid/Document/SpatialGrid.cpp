@@ -0,0 +1,188 @@
+#include "SpatialGrid.hpp"
+
+namespace Lucid {
+	namespace {
+		// Boxes spanning more cells than this are not worth listing in every one of them
+		constexpr long long maxCellsPerBox = 64;
+	}
+
+	SpatialGrid::SpatialGrid(float cellSize) : cellSize(cellSize > 0.0f ? cellSize : 64.0f)
+	{
+	}
+
+	void SpatialGrid::Insert(uint32_t id, const Div& box)
+	{
+		if (id >= entries.size()) entries.resize(id + 1);
+
+		Entry& entry = entries[id];
+		if (entry.live && entry.box.position == box.position && entry.box.size == box.size) return;
+
+		if (entry.live) Unlink(id);
+		else ++count;
+
+		entry.box = box;
+		entry.live = true;
+		entry.x0 = CellCoord(box.position.x);
+		entry.y0 = CellCoord(box.position.y);
+		entry.x1 = CellCoord(box.position.x + box.size.x);
+		entry.y1 = CellCoord(box.position.y + box.size.y);
+
+		long long covered = static_cast<long long>(entry.x1 - entry.x0 + 1) * (entry.y1 - entry.y0 + 1);
+		entry.large = covered > maxCellsPerBox;
+
+		if (entry.large) {
+			large.push_back(id);
+		}
+		else {
+			for (int y = entry.y0; y <= entry.y1; ++y) {
+				for (int x = entry.x0; x <= entry.x1; ++x) {
+					cells[CellKey(x, y)].push_back(id);
+				}
+			}
+		}
+
+		++version;
+	}
+
+	void SpatialGrid::Remove(uint32_t id)
+	{
+		if (id >= entries.size() || !entries[id].live) return;
+
+		Unlink(id);
+		entries[id].live = false;
+		--count;
+		++version;
+	}
+
+	void SpatialGrid::Clear()
+	{
+		entries.clear();
+		cells.clear();
+		large.clear();
+		count = 0;
+		++version;
+	}
+
+	uint32_t SpatialGrid::QueryPoint(glm::vec2 point) const
+	{
+		uint32_t hit = NoBox;
+
+		auto cell = cells.find(CellKey(CellCoord(point.x), CellCoord(point.y)));
+		if (cell != cells.end()) {
+			for (uint32_t id : cell->second) {
+				if ((hit == NoBox || id > hit) && Contains(entries[id].box, point)) hit = id;
+			}
+		}
+
+		for (uint32_t id : large) {
+			if ((hit == NoBox || id > hit) && Contains(entries[id].box, point)) hit = id;
+		}
+
+		return hit;
+	}
+
+	void SpatialGrid::QueryRect(const Div& rect, std::vector<uint32_t>& out) const
+	{
+		size_t first = out.size();
+
+		int x0 = CellCoord(rect.position.x), y0 = CellCoord(rect.position.y);
+		int x1 = CellCoord(rect.position.x + rect.size.x), y1 = CellCoord(rect.position.y + rect.size.y);
+
+		// A rectangle over more cells than there are boxes, like the whole page, is cheaper to answer by checking every box
+		long long covered = static_cast<long long>(x1 - x0 + 1) * (y1 - y0 + 1);
+		if (covered > static_cast<long long>(entries.size())) {
+			for (uint32_t id = 0; id < entries.size(); ++id) {
+				if (entries[id].live && Intersects(entries[id].box, rect)) out.push_back(id);
+			}
+			return;
+		}
+
+		if (visited.size() < entries.size()) visited.resize(entries.size(), 0);
+		if (++queryStamp == 0) {
+			// The stamp wrapped around, old marks could look current
+			std::fill(visited.begin(), visited.end(), 0);
+			queryStamp = 1;
+		}
+
+		for (int y = y0; y <= y1; ++y) {
+			for (int x = x0; x <= x1; ++x) {
+				auto cell = cells.find(CellKey(x, y));
+				if (cell == cells.end()) continue;
+
+				for (uint32_t id : cell->second) {
+					if (visited[id] == queryStamp) continue;
+					visited[id] = queryStamp;
+
+					if (Intersects(entries[id].box, rect)) out.push_back(id);
+				}
+			}
+		}
+
+		for (uint32_t id : large) {
+			if (Intersects(entries[id].box, rect)) out.push_back(id);
+		}
+
+		std::sort(out.begin() + first, out.end());
+	}
+
+	const Div* SpatialGrid::GetBox(uint32_t id) const
+	{
+		return (id < entries.size() && entries[id].live) ? &entries[id].box : nullptr;
+	}
+
+	uint64_t SpatialGrid::MemoryBytes() const
+	{
+		uint64_t bytes = MemoryStats::VectorBytes(entries) + MemoryStats::VectorBytes(large) + MemoryStats::VectorBytes(visited);
+		bytes += MemoryStats::HashMapBytes(cells);
+		for (const auto& [key, ids] : cells) bytes += MemoryStats::VectorBytes(ids);
+		return bytes;
+	}
+
+	bool SpatialGrid::Contains(const Div& box, glm::vec2 point)
+	{
+		return point.x >= box.position.x && point.x < box.position.x + box.size.x &&
+			point.y >= box.position.y && point.y < box.position.y + box.size.y;
+	}
+
+	bool SpatialGrid::Intersects(const Div& a, const Div& b)
+	{
+		return a.position.x <= b.position.x + b.size.x && b.position.x <= a.position.x + a.size.x &&
+			a.position.y <= b.position.y + b.size.y && b.position.y <= a.position.y + a.size.y;
+	}
+
+	uint64_t SpatialGrid::CellKey(int x, int y)
+	{
+		return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+	}
+
+	int SpatialGrid::CellCoord(float value) const
+	{
+		// Keeps far away or broken coordinates from overflowing the cell index
+		return static_cast<int>(std::clamp(std::floor(value / cellSize), -1.0e9f, 1.0e9f));
+	}
+
+	void SpatialGrid::Unlink(uint32_t id)
+	{
+		Entry& entry = entries[id];
+
+		if (entry.large) {
+			large.erase(std::find(large.begin(), large.end(), id));
+			return;
+		}
+
+		for (int y = entry.y0; y <= entry.y1; ++y) {
+			for (int x = entry.x0; x <= entry.x1; ++x) {
+				auto cell = cells.find(CellKey(x, y));
+				if (cell == cells.end()) continue;
+
+				std::vector<uint32_t>& ids = cell->second;
+				auto it = std::find(ids.begin(), ids.end(), id);
+				if (it != ids.end()) {
+					*it = ids.back();
+					ids.pop_back();
+				}
+				if (ids.empty()) cells.erase(cell);
+			}
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+
+#include "../Elements.hpp"
+#include "../Memory/MemoryStats.hpp"
+
+namespace Lucid {
+	// Uniform grid over axis aligned boxes, for hit testing and culling.
+	// Each box is listed in every cell it overlaps, so a point query only looks at the boxes of one cell.
+	// Boxes covering too many cells are kept in a separate list that every query checks
+	class SpatialGrid {
+	public:
+		static constexpr uint32_t NoBox = UINT32_MAX;
+
+		explicit SpatialGrid(float cellSize = 64.0f);
+
+		// Adds the box or moves it if the id is already in the grid
+		void Insert(uint32_t id, const Div& box);
+		void Remove(uint32_t id);
+		void Clear();
+
+		// Returns the highest id whose box contains the point, or NoBox
+		uint32_t QueryPoint(glm::vec2 point) const;
+		// Appends the ids of all boxes intersecting the rectangle to out, each once and in ascending order
+		void QueryRect(const Div& rect, std::vector<uint32_t>& out) const;
+
+		/* ---Getters--- */
+		// nullptr if the id is not in the grid
+		const Div* GetBox(uint32_t id) const;
+		size_t Size() const { return count; }
+		// Changes whenever a box is added, moved or removed
+		uint64_t Version() const { return version; }
+		// Heap memory of the entries, cells and query scratch
+		uint64_t MemoryBytes() const;
+
+	private:
+		struct Entry {
+			Div box{};
+			int x0 = 0, y0 = 0, x1 = -1, y1 = -1; // covered cells, inclusive
+			bool live = false;
+			bool large = false;
+		};
+
+		static bool Contains(const Div& box, glm::vec2 point);
+		static bool Intersects(const Div& a, const Div& b);
+		static uint64_t CellKey(int x, int y);
+
+		int CellCoord(float value) const;
+		void Unlink(uint32_t id);
+
+		float cellSize;
+		std::vector<Entry> entries; // indexed by id
+		std::unordered_map<uint64_t, std::vector<uint32_t>> cells;
+		std::vector<uint32_t> large;
+		size_t count = 0;
+		uint64_t version = 0;
+
+		// Makes sure boxes spanning several cells are only reported once per rectangle query
+		mutable std::vector<uint32_t> visited;
+		mutable uint32_t queryStamp = 0;
+	};
+}
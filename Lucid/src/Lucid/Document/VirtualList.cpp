@@ -0,0 +1,197 @@
+#include "VirtualList.hpp"
+#include "../Renderer/RenderStats.hpp"
+
+namespace Lucid {
+	VirtualList::VirtualList(size_t itemCount, ItemSource source) : itemCount(itemCount), source(std::move(source))
+	{
+	}
+
+	bool VirtualList::Update()
+	{
+		if (!dirty) return false;
+		dirty = false;
+
+		float height = GetRowHeight();
+		size_t visibleRows = bounds.size.y > 0.0f ? static_cast<size_t>(std::ceil(bounds.size.y / height)) + 1 : 0;
+		size_t capacity = visibleRows > 0 ? visibleRows + 2 * overscan : 0;
+
+		// Only happens when the list is resized, every row has to be refetched then
+		if (rows.size() != capacity) rows.assign(capacity, Row());
+
+		ClampScroll();
+
+		size_t firstVisible = std::min(static_cast<size_t>(scrollOffset / height), itemCount);
+		firstItem = firstVisible > overscan ? firstVisible - overscan : 0;
+		endItem = std::min(firstVisible + visibleRows + overscan, itemCount);
+		if (capacity == 0) endItem = firstItem;
+
+		for (size_t item = firstItem; item < endItem; ++item) {
+			Row& row = rows[item % capacity];
+
+			// Recycle rows that scrolled out, rows that stayed in view keep their text
+			if (row.item != item) {
+				row.item = item;
+				row.element.text = source ? source(item) : std::string();
+			}
+
+			double top = static_cast<double>(item) * height - scrollOffset;
+			row.element.position = bounds.position + glm::vec2(0.0f, static_cast<float>(top) + fontSize);
+			row.element.font = font;
+			row.element.fontSize = fontSize;
+			row.element.color = color;
+		}
+
+		return true;
+	}
+
+	void VirtualList::Draw(glm::vec2 viewportSize) const
+	{
+		if (rows.empty()) return;
+
+		// Rows are cut off at the list's edges, GL counts y from the bottom
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(static_cast<GLint>(bounds.position.x), static_cast<GLint>(viewportSize.y - bounds.position.y - bounds.size.y),
+			static_cast<GLsizei>(bounds.size.x), static_cast<GLsizei>(bounds.size.y));
+		RenderStats::CountCalls(2);
+
+		float height = GetRowHeight();
+		for (size_t item = firstItem; item < endItem; ++item) {
+			const TextElement& text = rows[item % rows.size()].element;
+
+			// Overscan rows are only kept ready, not drawn
+			float top = text.position.y - fontSize;
+			if (top + height < bounds.position.y || top > bounds.position.y + bounds.size.y) continue;
+
+			Text::setActiveFont(text.font);
+			Text::RenderText(text.text, viewportSize, text.position, text.fontSize, text.color);
+		}
+
+		glDisable(GL_SCISSOR_TEST);
+		RenderStats::CountCalls();
+	}
+
+	void VirtualList::ScrollBy(double pixels)
+	{
+		ScrollTo(scrollOffset + pixels);
+	}
+
+	void VirtualList::ScrollTo(double offset)
+	{
+		double previous = scrollOffset;
+		scrollOffset = offset;
+		ClampScroll();
+
+		if (scrollOffset != previous) dirty = true;
+	}
+
+	void VirtualList::ScrollToItem(size_t index)
+	{
+		ScrollTo(static_cast<double>(index) * GetRowHeight());
+	}
+
+	void VirtualList::ScrollToEnd()
+	{
+		ScrollTo(GetMaxScroll());
+	}
+
+	void VirtualList::InvalidateItem(size_t index)
+	{
+		if (rows.empty() || index < firstItem || index >= endItem) return;
+
+		rows[index % rows.size()].item = NoItem;
+		dirty = true;
+	}
+
+	void VirtualList::InvalidateAll()
+	{
+		for (Row& row : rows) {
+			row.item = NoItem;
+		}
+		dirty = true;
+	}
+
+	double VirtualList::GetMaxScroll() const
+	{
+		double contentHeight = static_cast<double>(itemCount) * GetRowHeight();
+		return std::max(0.0, contentHeight - bounds.size.y);
+	}
+
+	float VirtualList::GetRowHeight() const
+	{
+		return rowHeight > 0.0f ? rowHeight : std::max(fontSize * 1.25f, 1.0f);
+	}
+
+	bool VirtualList::Contains(glm::vec2 point) const
+	{
+		return point.x >= bounds.position.x && point.x < bounds.position.x + bounds.size.x &&
+			point.y >= bounds.position.y && point.y < bounds.position.y + bounds.size.y;
+	}
+
+	MemoryStats::Usage VirtualList::GetMemoryUsage() const
+	{
+		MemoryStats::Usage usage{ rows.size(), MemoryStats::VectorBytes(rows) + MemoryStats::StringBytes(font) };
+		for (const Row& row : rows) {
+			usage.bytes += MemoryStats::StringBytes(row.element.text) + MemoryStats::StringBytes(row.element.font);
+		}
+		return usage;
+	}
+
+	void VirtualList::SetItemCount(size_t count)
+	{
+		if (count == itemCount) return;
+
+		bool atEnd = scrollOffset >= GetMaxScroll();
+		itemCount = count;
+
+		// Rows past the new end may hold stale items if the list shrank
+		if (endItem > itemCount) InvalidateAll();
+		if (atEnd) scrollOffset = GetMaxScroll();
+
+		dirty = true;
+	}
+
+	void VirtualList::SetSource(ItemSource source)
+	{
+		this->source = std::move(source);
+		InvalidateAll();
+	}
+
+	void VirtualList::SetBounds(const Div& bounds)
+	{
+		if (this->bounds.position == bounds.position && this->bounds.size == bounds.size) return;
+
+		this->bounds = bounds;
+		dirty = true;
+	}
+
+	void VirtualList::SetStyle(const std::string& font, float fontSize, glm::vec4 color)
+	{
+		if (this->font == font && this->fontSize == fontSize && this->color == color) return;
+
+		this->font = font;
+		this->fontSize = fontSize;
+		this->color = color;
+		dirty = true;
+	}
+
+	void VirtualList::SetRowHeight(float height)
+	{
+		if (rowHeight == height) return;
+
+		rowHeight = height;
+		dirty = true;
+	}
+
+	void VirtualList::SetOverscan(size_t rows)
+	{
+		if (overscan == rows) return;
+
+		overscan = rows;
+		dirty = true;
+	}
+
+	void VirtualList::ClampScroll()
+	{
+		scrollOffset = std::clamp(scrollOffset, 0.0, GetMaxScroll());
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <functional>
+
+#include "../Elements.hpp"
+#include "../Text/Text.hpp"
+
+namespace Lucid {
+	// A scrolling list of text rows that only materializes the items around the visible area.
+	// Rows have a fixed height, so finding the visible items takes the same time for ten items as for millions,
+	// and row elements are recycled while scrolling, memory depends on the size of the list on screen, not on the item count
+	class VirtualList {
+	public:
+		// Returns the text of an item, only called for items that come into view (plus overscan)
+		using ItemSource = std::function<std::string(size_t index)>;
+
+		VirtualList(size_t itemCount, ItemSource source);
+
+		// Works out which items are in view and fills recycled rows. Returns true if anything on screen changed
+		bool Update();
+		// Draws the rows that intersect the list's bounds, clipped to them
+		void Draw(glm::vec2 viewportSize) const;
+
+		void ScrollBy(double pixels);
+		void ScrollTo(double offset);
+		void ScrollToItem(size_t index);
+		void ScrollToEnd();
+
+		// The item's text is fetched again if it is materialized
+		void InvalidateItem(size_t index);
+		void InvalidateAll();
+
+		/* ---Getters--- */
+		size_t GetItemCount() const { return itemCount; }
+		double GetScrollOffset() const { return scrollOffset; }
+		double GetMaxScroll() const;
+		float GetRowHeight() const;
+		const Div& GetBounds() const { return bounds; }
+		bool Contains(glm::vec2 point) const;
+		// Materialized items are [GetFirstItem(), GetEndItem())
+		size_t GetFirstItem() const { return firstItem; }
+		size_t GetEndItem() const { return endItem; }
+		// Number of row elements kept alive, the visible rows plus overscan on both sides
+		size_t GetRowCapacity() const { return rows.size(); }
+		// The materialized row elements
+		MemoryStats::Usage GetMemoryUsage() const;
+
+		/* ---Setters--- */
+		// A list scrolled to the end stays at the end while items are added, like a log view
+		void SetItemCount(size_t count);
+		void SetSource(ItemSource source);
+		void SetBounds(const Div& bounds);
+		void SetStyle(const std::string& font, float fontSize, glm::vec4 color);
+		// 0 uses 1.25 times the font size
+		void SetRowHeight(float height);
+		void SetOverscan(size_t rows);
+
+	private:
+		static constexpr size_t NoItem = std::numeric_limits<size_t>::max();
+
+		struct Row {
+			size_t item = NoItem;
+			TextElement element;
+		};
+
+		void ClampScroll();
+
+		size_t itemCount = 0;
+		ItemSource source;
+
+		// Item i lives in rows[i % rows.size()], so scrolling by one row only refills one element
+		std::vector<Row> rows;
+		size_t firstItem = 0;
+		size_t endItem = 0;
+
+		Div bounds{};
+		std::string font = "Arial";
+		float fontSize = 16.0f;
+		glm::vec4 color{ 1.0f };
+		float rowHeight = 0.0f;
+		size_t overscan = 4;
+
+		// Kept in double, float offsets start skipping whole pixels past a few hundred thousand rows
+		double scrollOffset = 0.0;
+		bool dirty = true;
+	};
+}
@@ -2,6 +2,7 @@
 
 #include <glm/glm.hpp>
 #include <string>
+#include <cstdint>
 
 struct Div {
 	glm::vec2 position;
@@ -14,4 +15,15 @@ struct TextElement {
 	float fontSize;
 	std::string font;
 	glm::vec4 color;
+
+	bool operator==(const TextElement& other) const = default;
+};
+
+struct ImageElement {
+	std::string src; // resolved path
+	glm::vec2 position;
+	glm::vec2 size; // an axis stays 0 while it follows the image's own size and that isn't known yet
+	uint32_t image; // handle from ImageCache::Request
+
+	bool operator==(const ImageElement& other) const = default;
 };
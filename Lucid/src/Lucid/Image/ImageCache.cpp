@@ -0,0 +1,422 @@
+#include "ImageCache.hpp"
+#include "../Renderer/GLState.hpp"
+#include "../Renderer/RenderStats.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <condition_variable>
+
+namespace Lucid {
+	namespace ImageCache {
+		// Finished decodes beyond this wait for the next frame, one image always goes through
+		constexpr size_t UploadBytesPerFrame = 4 << 20;
+
+		struct Source {
+			std::string path;
+			glm::ivec2 size{};
+			glm::ivec2 natural{};
+			uint64_t content = 0; // texture key, 0 until a worker has read the file
+			bool queued = false;  // waiting for or on a worker
+			bool failed = false;
+		};
+
+		struct Job {
+			Handle handle;
+			std::string path;
+			glm::ivec2 size;
+		};
+
+		struct Decoded {
+			uint64_t content;
+			glm::ivec2 size;
+			std::vector<unsigned char> pixels; // RGBA rows, top row first
+		};
+
+		struct Entry {
+			GLuint texture = 0;
+			uint64_t bytes = 0;
+			uint64_t lastUsed = 0; // frame it was last drawn in
+		};
+
+		// Everything below is guarded by lock, workers only hold it to take jobs and hand in results
+		std::mutex lock;
+		std::vector<Source> sources;
+		std::unordered_map<std::string, Handle> handles; // path and size
+		std::deque<Job> jobs;
+		std::deque<Decoded> decoded;
+		// Contents decoded, being decoded or uploaded. A worker that finds its content here skips the decode
+		std::unordered_set<uint64_t> claimed;
+		std::unordered_map<uint64_t, Entry> textures;
+		uint64_t textureBytes = 0;
+		uint64_t frame = 0;
+		Stats stats;
+		std::function<void()> wakeCallback;
+
+		std::atomic<uint64_t> version = 0;
+
+		// FNV-1a over the file, with the decoded size mixed in since scaled copies are separate textures
+		static uint64_t contentKey(const std::vector<unsigned char>& bytes, glm::ivec2 size)
+		{
+			uint64_t hash = 14695981039346656037ull;
+			for (unsigned char byte : bytes) hash = (hash ^ byte) * 1099511628211ull;
+			hash = (hash ^ static_cast<uint32_t>(size.x)) * 1099511628211ull;
+			hash = (hash ^ static_cast<uint32_t>(size.y)) * 1099511628211ull;
+			return hash ? hash : 1; // 0 means not read yet
+		}
+
+		// Never larger than the file, images are only scaled down
+		static glm::ivec2 outputSize(glm::ivec2 requested, glm::ivec2 natural)
+		{
+			glm::ivec2 size = requested;
+			if (size.x <= 0 && size.y <= 0) return natural;
+			if (size.x <= 0) size.x = natural.x * size.y / natural.y;
+			if (size.y <= 0) size.y = natural.y * size.x / natural.x;
+			return glm::ivec2(std::clamp(size.x, 1, natural.x), std::clamp(size.y, 1, natural.y));
+		}
+
+		// Averages the source pixels each output pixel covers, so small icons don't alias.
+		// Colors are weighted by alpha so transparent pixels don't darken the edges
+		static std::vector<unsigned char> scale(const unsigned char* pixels, glm::ivec2 from, glm::ivec2 to)
+		{
+			if (from == to) return std::vector<unsigned char>(pixels, pixels + static_cast<size_t>(from.x) * from.y * 4);
+
+			std::vector<unsigned char> result(static_cast<size_t>(to.x) * to.y * 4);
+			for (int y = 0; y < to.y; ++y) {
+				int y0 = static_cast<int>(static_cast<int64_t>(y) * from.y / to.y);
+				int y1 = std::max(y0 + 1, static_cast<int>(static_cast<int64_t>(y + 1) * from.y / to.y));
+				for (int x = 0; x < to.x; ++x) {
+					int x0 = static_cast<int>(static_cast<int64_t>(x) * from.x / to.x);
+					int x1 = std::max(x0 + 1, static_cast<int>(static_cast<int64_t>(x + 1) * from.x / to.x));
+
+					uint64_t r = 0, g = 0, b = 0, a = 0;
+					for (int sy = y0; sy < y1; ++sy) {
+						const unsigned char* pixel = pixels + (static_cast<size_t>(sy) * from.x + x0) * 4;
+						for (int sx = x0; sx < x1; ++sx, pixel += 4) {
+							r += pixel[0] * pixel[3];
+							g += pixel[1] * pixel[3];
+							b += pixel[2] * pixel[3];
+							a += pixel[3];
+						}
+					}
+
+					uint64_t count = static_cast<uint64_t>(y1 - y0) * (x1 - x0);
+					unsigned char* out = result.data() + (static_cast<size_t>(y) * to.x + x) * 4;
+					out[0] = a ? static_cast<unsigned char>((r + a / 2) / a) : 0;
+					out[1] = a ? static_cast<unsigned char>((g + a / 2) / a) : 0;
+					out[2] = a ? static_cast<unsigned char>((b + a / 2) / a) : 0;
+					out[3] = static_cast<unsigned char>((a + count / 2) / count);
+				}
+			}
+			return result;
+		}
+
+		static void notify()
+		{
+			++version;
+
+			std::function<void()> wake;
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				wake = wakeCallback;
+			}
+			if (wake) wake();
+		}
+
+		// Marks the request, and any waiting on the same content, as failed
+		static void fail(const Job& job, uint64_t content, const char* reason)
+		{
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				sources[job.handle].queued = false;
+				sources[job.handle].failed = true;
+				++stats.failed;
+				if (content) {
+					claimed.erase(content);
+					for (Source& source : sources) {
+						if (source.content == content) source.failed = true;
+					}
+				}
+			}
+			std::cout << "Failed to load image " << job.path << ": " << reason << std::endl;
+			notify();
+		}
+
+		static void decode(const Job& job)
+		{
+			std::ifstream file(job.path, std::ios::binary);
+			std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+			if (bytes.empty()) {
+				fail(job, 0, "could not read the file");
+				return;
+			}
+
+			// The header is enough to know the size, and with it whether this content was decoded already
+			int width = 0, height = 0, channels = 0;
+			if (!stbi_info_from_memory(bytes.data(), static_cast<int>(bytes.size()), &width, &height, &channels)) {
+				fail(job, 0, stbi_failure_reason());
+				return;
+			}
+			glm::ivec2 natural(width, height);
+			glm::ivec2 size = outputSize(job.size, natural);
+			uint64_t content = contentKey(bytes, size);
+
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				Source& source = sources[job.handle];
+				source.natural = natural;
+				source.content = content;
+				if (!claimed.insert(content).second) {
+					source.queued = false;
+					++stats.shared;
+					return;
+				}
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			unsigned char* pixels = stbi_load_from_memory(bytes.data(), static_cast<int>(bytes.size()), &width, &height, &channels, 4);
+			if (!pixels) {
+				fail(job, content, stbi_failure_reason());
+				return;
+			}
+			Decoded result{ content, size, scale(pixels, natural, size) };
+			stbi_image_free(pixels);
+			double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				decoded.push_back(std::move(result));
+				sources[job.handle].queued = false;
+				++stats.decoded;
+				stats.decodeMilliseconds += milliseconds;
+			}
+			notify();
+		}
+
+		// Started with the first request. Declared after the state above, so it is destroyed, and its threads
+		// joined, before the state they use
+		struct Workers {
+			std::vector<std::thread> threads;
+			std::condition_variable wake;
+			bool stopping = false;
+
+			void Start()
+			{
+				if (!threads.empty()) return;
+
+				// One core is left to the render thread
+				int count = std::clamp(static_cast<int>(std::thread::hardware_concurrency()) - 1, 1, 4);
+				for (int i = 0; i < count; ++i) {
+					threads.emplace_back([this]() { Run(); });
+				}
+			}
+
+			void Run()
+			{
+				while (true) {
+					Job job;
+					{
+						std::unique_lock<std::mutex> guard(lock);
+						wake.wait(guard, [this]() { return stopping || !jobs.empty(); });
+						if (stopping) return;
+						job = std::move(jobs.front());
+						jobs.pop_front();
+					}
+					decode(job);
+				}
+			}
+
+			~Workers()
+			{
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					stopping = true;
+				}
+				wake.notify_all();
+				for (std::thread& thread : threads) thread.join();
+			}
+		};
+		Workers workers;
+
+		// Needs the lock held
+		static void queue(Handle handle)
+		{
+			Source& source = sources[handle];
+			source.queued = true;
+			source.content = 0;
+			jobs.push_back({ handle, source.path, source.size });
+			workers.Start();
+			workers.wake.notify_one();
+		}
+
+		Handle Request(const std::string& path, glm::ivec2 size)
+		{
+			std::string key = path + "@" + std::to_string(size.x) + "x" + std::to_string(size.y);
+
+			std::lock_guard<std::mutex> guard(lock);
+			auto it = handles.find(key);
+			if (it != handles.end()) return it->second;
+
+			Handle handle = static_cast<Handle>(sources.size());
+			sources.push_back({ path, size });
+			handles.emplace(std::move(key), handle);
+			++stats.requests;
+			queue(handle);
+			return handle;
+		}
+
+		bool Upload()
+		{
+			std::vector<Decoded> ready;
+			bool more;
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				++frame;
+
+				size_t bytes = 0;
+				while (!decoded.empty() && (ready.empty() || bytes + decoded.front().pixels.size() <= UploadBytesPerFrame)) {
+					bytes += decoded.front().pixels.size();
+					ready.push_back(std::move(decoded.front()));
+					decoded.pop_front();
+				}
+				more = !decoded.empty();
+			}
+			if (ready.empty()) return more;
+
+			std::vector<std::pair<uint64_t, Entry>> uploaded;
+			for (const Decoded& image : ready) {
+				Entry entry;
+				glGenTextures(1, &entry.texture);
+				GLState::BindTexture(GL_TEXTURE_2D, entry.texture);
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.size.x, image.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+				// Already scaled to the size it is drawn at, no mipmaps needed
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				RenderStats::CountCalls(6);
+				RenderStats::CountUpload(image.pixels.size());
+
+				entry.bytes = image.pixels.size();
+				uploaded.push_back({ image.content, entry });
+			}
+
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				for (auto& [content, entry] : uploaded) {
+					entry.lastUsed = frame;
+					textures[content] = entry;
+					textureBytes += entry.bytes;
+					++stats.uploaded;
+				}
+			}
+
+			uint64_t limit = MemoryStats::GetLimits().imageTextureBytes;
+			if (limit > 0) Trim(limit);
+
+			++version;
+			return more;
+		}
+
+		GLuint GetTexture(Handle handle)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (handle >= sources.size()) return 0;
+
+			Source& source = sources[handle];
+			if (source.failed || source.queued) return 0;
+
+			auto it = textures.find(source.content);
+			if (it != textures.end()) {
+				it->second.lastUsed = frame;
+				return it->second.texture;
+			}
+
+			// Dropped by Trim since it was last drawn, decode it again
+			if (!claimed.count(source.content)) queue(handle);
+			return 0;
+		}
+
+		void Trim(uint64_t maxBytes)
+		{
+			std::vector<GLuint> dropped;
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				if (textureBytes <= maxBytes) return;
+
+				std::vector<std::pair<uint64_t, uint64_t>> byAge; // last used, content
+				for (const auto& [content, entry] : textures) {
+					// What is on screen now stays, even if it alone is over the limit
+					if (entry.lastUsed + 1 < frame) byAge.push_back({ entry.lastUsed, content });
+				}
+				std::sort(byAge.begin(), byAge.end());
+
+				for (const auto& [lastUsed, content] : byAge) {
+					if (textureBytes <= maxBytes) break;
+
+					auto it = textures.find(content);
+					textureBytes -= it->second.bytes;
+					dropped.push_back(it->second.texture);
+					textures.erase(it);
+					claimed.erase(content);
+					++stats.evicted;
+				}
+			}
+
+			for (GLuint texture : dropped) {
+				glDeleteTextures(1, &texture);
+				GLState::Forget(GLState::Object::Texture, texture);
+			}
+			if (!dropped.empty()) ++version;
+		}
+
+		glm::ivec2 GetNaturalSize(Handle handle)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			return handle < sources.size() ? sources[handle].natural : glm::ivec2(0);
+		}
+
+		uint64_t Version()
+		{
+			return version.load();
+		}
+
+		Stats GetStats()
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			return stats;
+		}
+
+		void CountMemory(MemoryStats::SharedUsage& usage)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			usage.imageTextures.count += textures.size();
+			usage.imageTextures.bytes += textureBytes;
+		}
+
+		void PrintStats(std::ostream& out)
+		{
+			Stats current = GetStats();
+			out << "Images: " << current.requests << " requested, " << current.decoded << " decoded in " << current.decodeMilliseconds
+				<< "ms, " << current.shared << " shared, " << current.failed << " failed, " << current.uploaded << " uploaded, "
+				<< current.evicted << " evicted" << std::endl;
+		}
+
+		void SetWakeCallback(std::function<void()> wake)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			wakeCallback = std::move(wake);
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <cstdint>
+#include <iostream>
+#include <functional>
+
+#include "../Memory/MemoryStats.hpp"
+
+namespace Lucid {
+	// Decoded images shared by all documents. Files are read, decoded and scaled down to the size they are shown at
+	// on a pool of worker threads, the thread drawing only uploads the finished pixels.
+	// Textures are keyed by the file's contents and their size, so the same icon under two names is decoded once.
+	// Past MemoryStats' image limit the textures drawn least recently are dropped, and decoded again if drawn again
+	namespace ImageCache {
+		using Handle = uint32_t;
+		constexpr Handle NoImage = UINT32_MAX;
+
+		struct Stats {
+			uint64_t requests = 0; // distinct files and sizes asked for
+			uint64_t decoded = 0;
+			uint64_t shared = 0;   // requests whose pixels were already decoded for another name or size
+			uint64_t failed = 0;
+			uint64_t uploaded = 0;
+			uint64_t evicted = 0;
+			double decodeMilliseconds = 0.0; // summed over the workers
+		};
+
+		// Safe from any thread. Starts decoding the file unless the same file and size was asked for before.
+		// size is what the image is drawn at, larger images are scaled down to it. An axis left at 0 keeps the
+		// image's aspect ratio, both at 0 keep its own size
+		Handle Request(const std::string& path, glm::ivec2 size);
+
+		// The thread owning the GL context only. Uploads the images that finished decoding, a few megabytes per call
+		// so a page full of them is spread over several frames. Returns true if some are still waiting
+		bool Upload();
+		// The texture to draw, 0 while it is decoding or if it failed. Marks it as drawn
+		GLuint GetTexture(Handle handle);
+		// Drops the textures drawn least recently down to maxBytes, except those drawn in the last two frames
+		void Trim(uint64_t maxBytes);
+
+		/* ---Getters--- */
+		// The size of the file's image, zero until the worker has read it
+		glm::ivec2 GetNaturalSize(Handle handle);
+		// Changes whenever a decode finishes or a texture is uploaded or dropped
+		uint64_t Version();
+		Stats GetStats();
+		void CountMemory(MemoryStats::SharedUsage& usage);
+		void PrintStats(std::ostream& out = std::cout);
+
+		/* ---Setters--- */
+		// Called from a worker when an image finished decoding, used to wake up the event loop
+		void SetWakeCallback(std::function<void()> wake);
+	}
+}
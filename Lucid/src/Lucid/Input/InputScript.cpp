@@ -0,0 +1,127 @@
+#include "../gui.hpp"
+#include "InputScript.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace Lucid {
+	namespace InputScript {
+		std::ofstream recording;
+		bool recordedSinceFrame = false;
+
+		std::vector<Event> Parse(std::istream& script)
+		{
+			std::vector<Event> events;
+
+			std::string line;
+			for (int number = 1; std::getline(script, line); ++number) {
+				line = line.substr(0, line.find('#'));
+				std::istringstream words(line);
+				std::string type;
+				if (!(words >> type)) continue;
+
+				Event event;
+				bool valid = true;
+				if (type == "frame") event.type = Event::Frame;
+				else if (type == "char") {
+					event.type = Event::Char;
+					valid = static_cast<bool>(words >> event.code);
+				}
+				else if (type == "text") {
+					// Everything after the first space, spaces included
+					std::string text;
+					std::getline(words >> std::ws, text);
+					for (unsigned char c : text) events.push_back({ Event::Char, c });
+					continue;
+				}
+				else if (type == "key") {
+					event.type = Event::Key;
+					valid = static_cast<bool>(words >> event.code >> event.action >> event.mods);
+				}
+				else if (type == "move") {
+					event.type = Event::Move;
+					valid = static_cast<bool>(words >> event.x >> event.y);
+				}
+				else if (type == "button") {
+					event.type = Event::Button;
+					valid = static_cast<bool>(words >> event.code >> event.action >> event.mods);
+				}
+				else if (type == "scroll") {
+					event.type = Event::Scroll;
+					valid = static_cast<bool>(words >> event.x >> event.y);
+				}
+				else valid = false;
+
+				if (!valid) throw std::runtime_error("Invalid input script line " + std::to_string(number) + ": " + line);
+				events.push_back(event);
+			}
+
+			return events;
+		}
+
+		std::vector<Event> Load(const std::string& path)
+		{
+			std::ifstream file(path);
+			if (!file) throw std::runtime_error("Failed to open input script: " + path);
+			return Parse(file);
+		}
+
+		void Write(std::ostream& out, const Event& event)
+		{
+			switch (event.type) {
+			case Event::Frame: out << "frame\n"; break;
+			case Event::Char: out << "char " << event.code << "\n"; break;
+			case Event::Key: out << "key " << event.code << " " << event.action << " " << event.mods << "\n"; break;
+			case Event::Move: out << "move " << event.x << " " << event.y << "\n"; break;
+			case Event::Button: out << "button " << event.code << " " << event.action << " " << event.mods << "\n"; break;
+			case Event::Scroll: out << "scroll " << event.x << " " << event.y << "\n"; break;
+			}
+		}
+
+		void Dispatch(const Event& event, GLFWwindow* window)
+		{
+			switch (event.type) {
+			case Event::Frame: break;
+			case Event::Char: char_callback(window, static_cast<unsigned int>(event.code)); break;
+			case Event::Key: key_callback(window, event.code, 0, event.action, event.mods); break;
+			case Event::Move: cursor_position_callback(window, event.x, event.y); break;
+			case Event::Button: mouse_button_callback(window, event.code, event.action, event.mods); break;
+			case Event::Scroll: scroll_callback(window, event.x, event.y); break;
+			}
+		}
+
+		void StartRecording(const std::string& path)
+		{
+			recording = std::ofstream(path);
+			if (!recording) std::cout << "Failed to open input recording: " << path << std::endl;
+			recordedSinceFrame = false;
+		}
+
+		void StopRecording()
+		{
+			RecordFrame();
+			recording.close();
+		}
+
+		bool IsRecording()
+		{
+			return recording.is_open();
+		}
+
+		void Record(const Event& event)
+		{
+			if (!recording.is_open()) return;
+
+			Write(recording, event);
+			recordedSinceFrame = true;
+		}
+
+		void RecordFrame()
+		{
+			if (!recording.is_open() || !recordedSinceFrame) return;
+
+			Write(recording, Event{ Event::Frame });
+			recordedSinceFrame = false;
+		}
+	}
+}
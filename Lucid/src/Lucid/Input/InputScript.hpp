@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+// Only used as a pointer here, glfw3.h has to come after glad and the .cpp includes both through gui.hpp
+struct GLFWwindow;
+
+namespace Lucid {
+	// Input recorded from the window's callbacks, to replay it later through the same callbacks without a window.
+	// Scripts are text, one event per line:
+	//   char 97             codepoint
+	//   text hello          one char event per (ascii) character
+	//   key 259 1 0         key, action and mods as GLFW gives them
+	//   move 120 40         cursor position
+	//   button 0 1 0        button, action and mods
+	//   scroll 0 -1         x and y offset
+	//   frame               the events above it arrive before one Update
+	// Empty lines and everything after a # are skipped
+	namespace InputScript {
+		struct Event {
+			enum Type : uint8_t {
+				Frame,
+				Char,
+				Key,
+				Move,
+				Button,
+				Scroll
+			} type = Frame;
+			int code = 0; // codepoint, key or button
+			int action = 0;
+			int mods = 0;
+			double x = 0.0, y = 0.0; // cursor position or scroll offset
+		};
+
+		// Throws if a line can't be read
+		std::vector<Event> Parse(std::istream& script);
+		std::vector<Event> Load(const std::string& path);
+		void Write(std::ostream& out, const Event& event);
+
+		// Calls the gui callback the event came from
+		void Dispatch(const Event& event, GLFWwindow* window = nullptr);
+
+		/* ---Recording--- */
+		// The gui callbacks append what they receive to the file until StopRecording
+		void StartRecording(const std::string& path);
+		void StopRecording();
+		bool IsRecording();
+		void Record(const Event& event);
+		// Ends the frame if anything was recorded since the last one, Update calls this
+		void RecordFrame();
+	}
+}
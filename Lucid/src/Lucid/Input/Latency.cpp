@@ -0,0 +1,120 @@
+#include "Latency.hpp"
+
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+namespace Lucid {
+	namespace Latency {
+		using Clock = std::chrono::steady_clock;
+
+		struct Pending {
+			Event event;
+			Clock::time_point time;
+		};
+
+		std::vector<Pending> pending;
+		std::array<Histogram, static_cast<size_t>(Event::Count)> histograms;
+		Histogram combined;
+
+		int Histogram::BucketOf(double microseconds)
+		{
+			if (microseconds < 1.0) return 0;
+
+			// microseconds = mantissa * 2^exponent with the mantissa in [0.5, 1)
+			int exponent;
+			double mantissa = std::frexp(microseconds, &exponent);
+			int bucket = (exponent - 1) * SubBuckets + static_cast<int>((mantissa * 2.0 - 1.0) * SubBuckets);
+			return std::min(bucket, Buckets - 1);
+		}
+
+		double Histogram::UpperEdge(int bucket)
+		{
+			int doubling = bucket / SubBuckets;
+			int sub = bucket % SubBuckets;
+			return std::ldexp(1.0 + (sub + 1.0) / SubBuckets, doubling) / 1000.0;
+		}
+
+		void Histogram::Add(double milliseconds)
+		{
+			++counts[BucketOf(milliseconds * 1000.0)];
+			++count;
+			sum += milliseconds;
+			max = std::max(max, milliseconds);
+		}
+
+		void Histogram::Clear()
+		{
+			*this = Histogram();
+		}
+
+		double Histogram::Percentile(double percentile) const
+		{
+			if (count == 0) return 0.0;
+
+			uint64_t rank = static_cast<uint64_t>(std::ceil(percentile / 100.0 * count));
+			rank = std::clamp<uint64_t>(rank, 1, count);
+
+			uint64_t seen = 0;
+			for (int bucket = 0; bucket < Buckets; ++bucket) {
+				seen += counts[bucket];
+				if (seen >= rank) return std::min(UpperEdge(bucket), max);
+			}
+			return max;
+		}
+
+		void MarkInput(Event event)
+		{
+			pending.push_back({ event, Clock::now() });
+		}
+
+		void MarkPresented()
+		{
+			Clock::time_point now = Clock::now();
+			for (const Pending& input : pending) {
+				double milliseconds = std::chrono::duration<double, std::milli>(now - input.time).count();
+				histograms[static_cast<size_t>(input.event)].Add(milliseconds);
+				combined.Add(milliseconds);
+			}
+			pending.clear();
+		}
+
+		void DiscardPending()
+		{
+			pending.clear();
+		}
+
+		const Histogram& GetHistogram(Event event)
+		{
+			return histograms[static_cast<size_t>(event)];
+		}
+
+		const Histogram& GetHistogram()
+		{
+			return combined;
+		}
+
+		void Reset()
+		{
+			pending.clear();
+			for (Histogram& histogram : histograms) histogram.Clear();
+			combined.Clear();
+		}
+
+		void PrintStats(std::ostream& out)
+		{
+			const char* names[] = { "char", "key", "mouse move", "mouse button", "scroll" };
+
+			out << "Input to present latency (ms):" << std::endl;
+			for (size_t event = 0; event < histograms.size(); ++event) {
+				const Histogram& histogram = histograms[event];
+				if (histogram.Count() == 0) continue;
+
+				out << "  " << names[event] << ": " << histogram.Count() << " events, mean " << histogram.Mean()
+					<< ", p50 " << histogram.Percentile(50.0) << ", p95 " << histogram.Percentile(95.0)
+					<< ", p99 " << histogram.Percentile(99.0) << ", max " << histogram.Max() << std::endl;
+			}
+		}
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <iostream>
+
+namespace Lucid {
+	// Measures how long input takes to reach the screen. Events are stamped when their callback is entered
+	// and matched with the next frame that is presented. When Update decides not to draw, the waiting events
+	// had nothing to show and are dropped instead of being charged to a later, unrelated frame
+	namespace Latency {
+		enum class Event : uint8_t {
+			Char,
+			Key,
+			MouseMove,
+			MouseButton,
+			Scroll,
+			Count
+		};
+
+		// Log scale histogram in milliseconds, takes the same memory however many samples it gets
+		class Histogram {
+		public:
+			void Add(double milliseconds);
+			void Clear();
+
+			/* ---Getters--- */
+			uint64_t Count() const { return count; }
+			double Mean() const { return count ? sum / count : 0.0; }
+			double Max() const { return max; }
+			// Upper edge of the bucket holding the percentile, at most 1/SubBuckets above the actual value
+			double Percentile(double percentile) const;
+
+		private:
+			// Bucket i covers one SubBuckets'th of a doubling, starting from a microsecond up to about 16 seconds
+			static constexpr int SubBuckets = 8;
+			static constexpr int Buckets = SubBuckets * 24;
+
+			static int BucketOf(double microseconds);
+			static double UpperEdge(int bucket);
+
+			std::array<uint64_t, Buckets> counts{};
+			uint64_t count = 0;
+			double sum = 0.0;
+			double max = 0.0;
+		};
+
+		// Call at the start of the input callback
+		void MarkInput(Event event);
+		// Call once the frame has been handed to the driver, right after glfwSwapBuffers
+		void MarkPresented();
+		// Call when a frame is skipped
+		void DiscardPending();
+
+		/* ---Getters--- */
+		const Histogram& GetHistogram(Event event);
+		// All events together
+		const Histogram& GetHistogram();
+		void Reset();
+		void PrintStats(std::ostream& out = std::cout);
+	}
+}
@@ -0,0 +1,104 @@
+#include "MemoryStats.hpp"
+#include "../Text/Text.hpp"
+#include "../Image/ImageCache.hpp"
+#include "../Renderer/BoxRenderer.hpp"
+#include "../Renderer/ImageRenderer.hpp"
+
+namespace Lucid {
+	namespace MemoryStats {
+		Limits limits;
+
+		// Red-black tree node: three links and the color, padded
+		constexpr uint64_t TreeNodeBytes = 4 * sizeof(void*);
+
+		Usage& Usage::operator+=(const Usage& other)
+		{
+			count += other.count;
+			bytes += other.bytes;
+			return *this;
+		}
+
+		uint64_t DocumentUsage::bytes() const
+		{
+			return dom.bytes + styles.bytes + styleCache.bytes + textElements.bytes + layout.bytes + images.bytes;
+		}
+
+		uint64_t SharedUsage::cpuBytes() const
+		{
+			return fonts.bytes + glyphs.bytes;
+		}
+
+		uint64_t SharedUsage::gpuBytes() const
+		{
+			return glyphTextures.bytes + gpuBuffers.bytes + imageTextures.bytes;
+		}
+
+		uint64_t StringBytes(const std::string& text)
+		{
+			// Short strings live inside the object
+			static const size_t inlineCapacity = std::string().capacity();
+			return text.capacity() > inlineCapacity ? text.capacity() + 1 : 0;
+		}
+
+		uint64_t MapBytes(const std::map<std::string, std::string>& map)
+		{
+			uint64_t bytes = map.size() * (TreeNodeBytes + sizeof(std::pair<const std::string, std::string>));
+			for (const auto& [key, value] : map) bytes += StringBytes(key) + StringBytes(value);
+			return bytes;
+		}
+
+		SharedUsage GetSharedUsage()
+		{
+			SharedUsage usage;
+			Text::CountMemory(usage);
+			BoxRenderer::CountMemory(usage);
+			ImageRenderer::CountMemory(usage);
+			ImageCache::CountMemory(usage);
+			return usage;
+		}
+
+		void SetLimits(const Limits& newLimits)
+		{
+			limits = newLimits;
+			Trim();
+		}
+
+		const Limits& GetLimits()
+		{
+			return limits;
+		}
+
+		void Trim()
+		{
+			if (limits.glyphTextureBytes > 0) Text::TrimGlyphs(limits.glyphTextureBytes);
+			if (limits.imageTextureBytes > 0) ImageCache::Trim(limits.imageTextureBytes);
+		}
+
+		static void PrintUsage(std::ostream& out, const char* name, const Usage& usage)
+		{
+			out << "  " << name << ": " << usage.count << " (" << usage.bytes / 1024.0 << " KiB)" << std::endl;
+		}
+
+		void PrintStats(const SharedUsage& shared, std::ostream& out)
+		{
+			out << "Shared: " << shared.cpuBytes() / 1024.0 << " KiB CPU, " << shared.gpuBytes() / 1024.0 << " KiB GPU" << std::endl;
+			PrintUsage(out, "fonts", shared.fonts);
+			PrintUsage(out, "glyphs", shared.glyphs);
+			PrintUsage(out, "glyph textures", shared.glyphTextures);
+			PrintUsage(out, "gpu buffers", shared.gpuBuffers);
+			PrintUsage(out, "image textures", shared.imageTextures);
+		}
+
+		void PrintStats(const DocumentUsage& document, const SharedUsage& shared, std::ostream& out)
+		{
+			out << "Document: " << document.bytes() / 1024.0 << " KiB" << std::endl;
+			PrintUsage(out, "dom nodes", document.dom);
+			PrintUsage(out, "styles", document.styles);
+			PrintUsage(out, "style cache", document.styleCache);
+			PrintUsage(out, "text elements", document.textElements);
+			PrintUsage(out, "layout", document.layout);
+			PrintUsage(out, "images", document.images);
+			PrintStats(shared, out);
+		}
+	}
+}
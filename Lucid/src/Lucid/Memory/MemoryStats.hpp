@@ -0,0 +1,82 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+namespace Lucid {
+	// Estimates how much memory pages and the shared font and glyph caches take, for the profiler overlay and for
+	// planning how many documents fit on a host. Heap sizes are worked out from sizes and capacities and GPU sizes
+	// from texture and buffer dimensions, so allocator and driver overhead is not included
+	namespace MemoryStats {
+		struct Usage {
+			uint64_t count = 0;
+			uint64_t bytes = 0;
+
+			Usage& operator+=(const Usage& other);
+		};
+
+		// Owned by one document
+		struct DocumentUsage {
+			Usage dom;          // nodes with their strings, attributes, inline styles and children
+			Usage styles;       // distinct computed styles and the style sheet rules
+			Usage styleCache;   // entries of the shared style cache
+			Usage textElements; // elements of the page and materialized list rows
+			Usage layout;       // spatial index, lookup tables and backgrounds
+			Usage images;       // image elements, their textures are shared
+
+			uint64_t bytes() const;
+		};
+
+		// Shared by all documents through Text and the renderers
+		struct SharedUsage {
+			Usage fonts;         // loaded fonts, file data included, embedded data is not copied and not counted
+			Usage glyphs;        // CPU side glyph metrics, counted per glyph
+			Usage glyphTextures; // estimated GPU memory of the glyph textures
+			Usage gpuBuffers;    // estimated GPU memory of the vertex and instance buffers
+			Usage imageTextures; // decoded images on the GPU
+
+			uint64_t cpuBytes() const;
+			uint64_t gpuBytes() const;
+		};
+
+		// Soft limits, 0 means no limit. Crossing one trims the matching cache instead of failing
+		struct Limits {
+			// Glyphs of the font sizes drawn least recently are dropped, down to this
+			uint64_t glyphTextureBytes = 0;
+			// The style cache is emptied when it grows past this, nodes keep their styles
+			uint64_t styleCacheEntries = 0;
+			// Images drawn least recently are dropped down to this and decoded again when they are drawn again.
+			// Limited by default, pages can hold any number of images
+			uint64_t imageTextureBytes = 256ull << 20;
+		};
+
+		// Heap memory a string, container or string map owns beyond its own object
+		uint64_t StringBytes(const std::string& text);
+		uint64_t MapBytes(const std::map<std::string, std::string>& map);
+		template<typename T>
+		uint64_t VectorBytes(const std::vector<T>& vector) { return vector.capacity() * sizeof(T); }
+		// Nodes and buckets only, add what the keys and values own separately
+		template<typename Map>
+		uint64_t HashMapBytes(const Map& map)
+		{
+			return map.size() * (sizeof(typename Map::value_type) + 2 * sizeof(void*)) + map.bucket_count() * sizeof(void*);
+		}
+		// The control block std::make_shared puts in front of the object
+		constexpr uint64_t SharedBlockBytes = 2 * sizeof(void*);
+
+		// Gathered from Text, ImageCache and the renderers
+		SharedUsage GetSharedUsage();
+
+		/* ---Limits--- */
+		void SetLimits(const Limits& limits);
+		const Limits& GetLimits();
+		// Applies the shared limits now instead of at the next glyph generation
+		void Trim();
+
+		void PrintStats(const SharedUsage& shared, std::ostream& out = std::cout);
+		void PrintStats(const DocumentUsage& document, const SharedUsage& shared, std::ostream& out = std::cout);
+	}
+}
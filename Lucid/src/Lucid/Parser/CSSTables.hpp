@@ -0,0 +1,368 @@
+#pragma once
+#include <array>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+namespace Lucid {
+	namespace Parser {
+		// Maps a fixed set of names to values with one hash and one string compare, built entirely at compile time.
+		// The keys are spread over buckets, and every bucket gets the displacement that puts all of its keys in free
+		// slots (hash and displace), so no two keys share a slot and a lookup never probes
+		template<typename Value, size_t N>
+		class PerfectHashTable {
+		public:
+			struct Entry {
+				std::string_view key;
+				Value value{};
+			};
+
+			consteval PerfectHashTable(const std::array<Entry, N>& entries)
+			{
+				// Keys grouped by bucket, fullest buckets first so they are placed while there is the most room
+				std::array<uint64_t, N> hashes{};
+				std::array<size_t, Buckets + 1> bucketStart{};
+				size_t largest = 0;
+				for (size_t i = 0; i < N; ++i) {
+					if (entries[i].key.empty()) throw "empty keys can't be looked up";
+					hashes[i] = Hash(entries[i].key);
+					largest = std::max(largest, ++bucketStart[BucketOf(hashes[i]) + 1]);
+				}
+				std::array<size_t, Buckets> order{};
+				size_t ordered = 0;
+				for (size_t size = largest; size > 0; --size) {
+					for (size_t bucket = 0; bucket < Buckets; ++bucket) {
+						if (bucketStart[bucket + 1] == size) order[ordered++] = bucket;
+					}
+				}
+				for (size_t bucket = 0; bucket < Buckets; ++bucket) {
+					bucketStart[bucket + 1] += bucketStart[bucket];
+				}
+				std::array<size_t, N> members{};
+				std::array<size_t, Buckets> filled{};
+				for (size_t i = 0; i < N; ++i) {
+					size_t bucket = BucketOf(hashes[i]);
+					members[bucketStart[bucket] + filled[bucket]++] = i;
+				}
+
+				std::array<bool, Slots> taken{};
+				for (size_t next = 0; next < ordered; ++next) {
+					size_t bucket = order[next];
+					const size_t* first = members.data() + bucketStart[bucket];
+					size_t count = bucketStart[bucket + 1] - bucketStart[bucket];
+
+					uint32_t displacement = 0;
+					while (!Fits(hashes, first, count, displacement, taken)) {
+						if (++displacement == 0xFFFF) throw "no displacement found, two keys probably hash the same";
+					}
+
+					displacements[bucket] = static_cast<uint16_t>(displacement);
+					for (size_t i = 0; i < count; ++i) {
+						size_t slot = SlotOf(hashes[first[i]], displacement);
+						taken[slot] = true;
+						slots[slot] = entries[first[i]];
+					}
+				}
+			}
+
+			// nullptr if the key isn't in the table
+			constexpr const Value* find(std::string_view key) const
+			{
+				uint64_t hash = Hash(key);
+				const Entry& entry = slots[SlotOf(hash, displacements[BucketOf(hash)])];
+				return !key.empty() && entry.key == key ? &entry.value : nullptr;
+			}
+
+			constexpr size_t size() const { return N; }
+
+		private:
+			static constexpr size_t Buckets = std::bit_ceil(N / 2 + 1);
+			static constexpr size_t Slots = std::bit_ceil(N + N / 2 + 1);
+
+			std::array<uint16_t, Buckets> displacements{};
+			std::array<Entry, Slots> slots{};
+
+			static constexpr uint64_t Hash(std::string_view key)
+			{
+				// FNV-1a, then a final mix so the high bits depend on every character
+				uint64_t hash = 14695981039346656037ull;
+				for (char c : key) {
+					hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+				}
+				hash ^= hash >> 29;
+				hash *= 0xBF58476D1CE4E5B9ull;
+				return hash ^ (hash >> 32);
+			}
+
+			static constexpr size_t BucketOf(uint64_t hash)
+			{
+				return static_cast<size_t>(hash >> 48) & (Buckets - 1);
+			}
+
+			// The step is odd and the slot count a power of two, so the displacements of a key visit every slot
+			static constexpr size_t SlotOf(uint64_t hash, uint32_t displacement)
+			{
+				uint32_t start = static_cast<uint32_t>(hash);
+				uint32_t step = static_cast<uint32_t>(hash >> 24) | 1u;
+				return static_cast<size_t>(start + displacement * step) & (Slots - 1);
+			}
+
+			static constexpr bool Fits(const std::array<uint64_t, N>& hashes, const size_t* members, size_t count,
+				uint32_t displacement, const std::array<bool, Slots>& taken)
+			{
+				for (size_t i = 0; i < count; ++i) {
+					size_t slot = SlotOf(hashes[members[i]], displacement);
+					if (taken[slot]) return false;
+					for (size_t j = 0; j < i; ++j) {
+						if (SlotOf(hashes[members[j]], displacement) == slot) return false;
+					}
+				}
+				return true;
+			}
+		};
+
+		template<typename Value, typename... Entries>
+		consteval auto MakePerfectHashTable(Entries... entries)
+		{
+			using Table = PerfectHashTable<Value, sizeof...(Entries)>;
+			return Table(std::array<typename Table::Entry, sizeof...(Entries)>{ typename Table::Entry{ entries.first, entries.second }... });
+		}
+
+		// The css property names the parser understands
+		enum class PropertyName : uint8_t {
+			Color,
+			FontSize,
+			FontFamily,
+			FontWeight,
+			Background,
+			BackgroundColor,
+			Top,
+			Left,
+			Width,
+			Height,
+			Border,
+			BorderWidth,
+			BorderColor,
+			BorderRadius,
+			Padding,
+			Margin
+		};
+
+		// Keywords that can show up in the values of those properties
+		enum class Keyword : uint8_t {
+			None,
+			Hidden,
+			Solid,
+			Dashed,
+			Dotted,
+			Double,
+			Groove,
+			Ridge,
+			Inset,
+			Outset,
+			Normal,
+			Bold,
+			Bolder,
+			Lighter,
+			Thin,
+			Medium,
+			Thick,
+			Transparent
+		};
+
+		inline constexpr auto propertyNames = MakePerfectHashTable<PropertyName>(
+			std::pair{ "color", PropertyName::Color },
+			std::pair{ "font-size", PropertyName::FontSize },
+			std::pair{ "font-family", PropertyName::FontFamily },
+			std::pair{ "font-weight", PropertyName::FontWeight },
+			std::pair{ "background", PropertyName::Background },
+			std::pair{ "background-color", PropertyName::BackgroundColor },
+			std::pair{ "top", PropertyName::Top },
+			std::pair{ "left", PropertyName::Left },
+			std::pair{ "width", PropertyName::Width },
+			std::pair{ "height", PropertyName::Height },
+			std::pair{ "border", PropertyName::Border },
+			std::pair{ "border-width", PropertyName::BorderWidth },
+			std::pair{ "border-color", PropertyName::BorderColor },
+			std::pair{ "border-radius", PropertyName::BorderRadius },
+			std::pair{ "padding", PropertyName::Padding },
+			std::pair{ "margin", PropertyName::Margin }
+		);
+
+		inline constexpr auto keywords = MakePerfectHashTable<Keyword>(
+			std::pair{ "none", Keyword::None },
+			std::pair{ "hidden", Keyword::Hidden },
+			std::pair{ "solid", Keyword::Solid },
+			std::pair{ "dashed", Keyword::Dashed },
+			std::pair{ "dotted", Keyword::Dotted },
+			std::pair{ "double", Keyword::Double },
+			std::pair{ "groove", Keyword::Groove },
+			std::pair{ "ridge", Keyword::Ridge },
+			std::pair{ "inset", Keyword::Inset },
+			std::pair{ "outset", Keyword::Outset },
+			std::pair{ "normal", Keyword::Normal },
+			std::pair{ "bold", Keyword::Bold },
+			std::pair{ "bolder", Keyword::Bolder },
+			std::pair{ "lighter", Keyword::Lighter },
+			std::pair{ "thin", Keyword::Thin },
+			std::pair{ "medium", Keyword::Medium },
+			std::pair{ "thick", Keyword::Thick },
+			std::pair{ "transparent", Keyword::Transparent }
+		);
+
+		// The css named colors as 0xRRGGBB, all opaque
+		inline constexpr auto namedColors = MakePerfectHashTable<uint32_t>(
+			std::pair{ "aliceblue", 0xF0F8FFu },
+			std::pair{ "antiquewhite", 0xFAEBD7u },
+			std::pair{ "aqua", 0x00FFFFu },
+			std::pair{ "aquamarine", 0x7FFFD4u },
+			std::pair{ "azure", 0xF0FFFFu },
+			std::pair{ "beige", 0xF5F5DCu },
+			std::pair{ "bisque", 0xFFE4C4u },
+			std::pair{ "black", 0x000000u },
+			std::pair{ "blanchedalmond", 0xFFEBCDu },
+			std::pair{ "blue", 0x0000FFu },
+			std::pair{ "blueviolet", 0x8A2BE2u },
+			std::pair{ "brown", 0xA52A2Au },
+			std::pair{ "burlywood", 0xDEB887u },
+			std::pair{ "cadetblue", 0x5F9EA0u },
+			std::pair{ "chartreuse", 0x7FFF00u },
+			std::pair{ "chocolate", 0xD2691Eu },
+			std::pair{ "coral", 0xFF7F50u },
+			std::pair{ "cornflowerblue", 0x6495EDu },
+			std::pair{ "cornsilk", 0xFFF8DCu },
+			std::pair{ "crimson", 0xDC143Cu },
+			std::pair{ "cyan", 0x00FFFFu },
+			std::pair{ "darkblue", 0x00008Bu },
+			std::pair{ "darkcyan", 0x008B8Bu },
+			std::pair{ "darkgoldenrod", 0xB8860Bu },
+			std::pair{ "darkgray", 0xA9A9A9u },
+			std::pair{ "darkgreen", 0x006400u },
+			std::pair{ "darkgrey", 0xA9A9A9u },
+			std::pair{ "darkkhaki", 0xBDB76Bu },
+			std::pair{ "darkmagenta", 0x8B008Bu },
+			std::pair{ "darkolivegreen", 0x556B2Fu },
+			std::pair{ "darkorange", 0xFF8C00u },
+			std::pair{ "darkorchid", 0x9932CCu },
+			std::pair{ "darkred", 0x8B0000u },
+			std::pair{ "darksalmon", 0xE9967Au },
+			std::pair{ "darkseagreen", 0x8FBC8Fu },
+			std::pair{ "darkslateblue", 0x483D8Bu },
+			std::pair{ "darkslategray", 0x2F4F4Fu },
+			std::pair{ "darkslategrey", 0x2F4F4Fu },
+			std::pair{ "darkturquoise", 0x00CED1u },
+			std::pair{ "darkviolet", 0x9400D3u },
+			std::pair{ "deeppink", 0xFF1493u },
+			std::pair{ "deepskyblue", 0x00BFFFu },
+			std::pair{ "dimgray", 0x696969u },
+			std::pair{ "dimgrey", 0x696969u },
+			std::pair{ "dodgerblue", 0x1E90FFu },
+			std::pair{ "firebrick", 0xB22222u },
+			std::pair{ "floralwhite", 0xFFFAF0u },
+			std::pair{ "forestgreen", 0x228B22u },
+			std::pair{ "fuchsia", 0xFF00FFu },
+			std::pair{ "gainsboro", 0xDCDCDCu },
+			std::pair{ "ghostwhite", 0xF8F8FFu },
+			std::pair{ "gold", 0xFFD700u },
+			std::pair{ "goldenrod", 0xDAA520u },
+			std::pair{ "gray", 0x808080u },
+			std::pair{ "green", 0x008000u },
+			std::pair{ "greenyellow", 0xADFF2Fu },
+			std::pair{ "grey", 0x808080u },
+			std::pair{ "honeydew", 0xF0FFF0u },
+			std::pair{ "hotpink", 0xFF69B4u },
+			std::pair{ "indianred", 0xCD5C5Cu },
+			std::pair{ "indigo", 0x4B0082u },
+			std::pair{ "ivory", 0xFFFFF0u },
+			std::pair{ "khaki", 0xF0E68Cu },
+			std::pair{ "lavender", 0xE6E6FAu },
+			std::pair{ "lavenderblush", 0xFFF0F5u },
+			std::pair{ "lawngreen", 0x7CFC00u },
+			std::pair{ "lemonchiffon", 0xFFFACDu },
+			std::pair{ "lightblue", 0xADD8E6u },
+			std::pair{ "lightcoral", 0xF08080u },
+			std::pair{ "lightcyan", 0xE0FFFFu },
+			std::pair{ "lightgoldenrodyellow", 0xFAFAD2u },
+			std::pair{ "lightgray", 0xD3D3D3u },
+			std::pair{ "lightgreen", 0x90EE90u },
+			std::pair{ "lightgrey", 0xD3D3D3u },
+			std::pair{ "lightpink", 0xFFB6C1u },
+			std::pair{ "lightsalmon", 0xFFA07Au },
+			std::pair{ "lightseagreen", 0x20B2AAu },
+			std::pair{ "lightskyblue", 0x87CEFAu },
+			std::pair{ "lightslategray", 0x778899u },
+			std::pair{ "lightslategrey", 0x778899u },
+			std::pair{ "lightsteelblue", 0xB0C4DEu },
+			std::pair{ "lightyellow", 0xFFFFE0u },
+			std::pair{ "lime", 0x00FF00u },
+			std::pair{ "limegreen", 0x32CD32u },
+			std::pair{ "linen", 0xFAF0E6u },
+			std::pair{ "magenta", 0xFF00FFu },
+			std::pair{ "maroon", 0x800000u },
+			std::pair{ "mediumaquamarine", 0x66CDAAu },
+			std::pair{ "mediumblue", 0x0000CDu },
+			std::pair{ "mediumorchid", 0xBA55D3u },
+			std::pair{ "mediumpurple", 0x9370DBu },
+			std::pair{ "mediumseagreen", 0x3CB371u },
+			std::pair{ "mediumslateblue", 0x7B68EEu },
+			std::pair{ "mediumspringgreen", 0x00FA9Au },
+			std::pair{ "mediumturquoise", 0x48D1CCu },
+			std::pair{ "mediumvioletred", 0xC71585u },
+			std::pair{ "midnightblue", 0x191970u },
+			std::pair{ "mintcream", 0xF5FFFAu },
+			std::pair{ "mistyrose", 0xFFE4E1u },
+			std::pair{ "moccasin", 0xFFE4B5u },
+			std::pair{ "navajowhite", 0xFFDEADu },
+			std::pair{ "navy", 0x000080u },
+			std::pair{ "oldlace", 0xFDF5E6u },
+			std::pair{ "olive", 0x808000u },
+			std::pair{ "olivedrab", 0x6B8E23u },
+			std::pair{ "orange", 0xFFA500u },
+			std::pair{ "orangered", 0xFF4500u },
+			std::pair{ "orchid", 0xDA70D6u },
+			std::pair{ "palegoldenrod", 0xEEE8AAu },
+			std::pair{ "palegreen", 0x98FB98u },
+			std::pair{ "paleturquoise", 0xAFEEEEu },
+			std::pair{ "palevioletred", 0xDB7093u },
+			std::pair{ "papayawhip", 0xFFEFD5u },
+			std::pair{ "peachpuff", 0xFFDAB9u },
+			std::pair{ "peru", 0xCD853Fu },
+			std::pair{ "pink", 0xFFC0CBu },
+			std::pair{ "plum", 0xDDA0DDu },
+			std::pair{ "powderblue", 0xB0E0E6u },
+			std::pair{ "purple", 0x800080u },
+			std::pair{ "rebeccapurple", 0x663399u },
+			std::pair{ "red", 0xFF0000u },
+			std::pair{ "rosybrown", 0xBC8F8Fu },
+			std::pair{ "royalblue", 0x4169E1u },
+			std::pair{ "saddlebrown", 0x8B4513u },
+			std::pair{ "salmon", 0xFA8072u },
+			std::pair{ "sandybrown", 0xF4A460u },
+			std::pair{ "seagreen", 0x2E8B57u },
+			std::pair{ "seashell", 0xFFF5EEu },
+			std::pair{ "sienna", 0xA0522Du },
+			std::pair{ "silver", 0xC0C0C0u },
+			std::pair{ "skyblue", 0x87CEEBu },
+			std::pair{ "slateblue", 0x6A5ACDu },
+			std::pair{ "slategray", 0x708090u },
+			std::pair{ "slategrey", 0x708090u },
+			std::pair{ "snow", 0xFFFAFAu },
+			std::pair{ "springgreen", 0x00FF7Fu },
+			std::pair{ "steelblue", 0x4682B4u },
+			std::pair{ "tan", 0xD2B48Cu },
+			std::pair{ "teal", 0x008080u },
+			std::pair{ "thistle", 0xD8BFD8u },
+			std::pair{ "tomato", 0xFF6347u },
+			std::pair{ "turquoise", 0x40E0D0u },
+			std::pair{ "violet", 0xEE82EEu },
+			std::pair{ "wheat", 0xF5DEB3u },
+			std::pair{ "white", 0xFFFFFFu },
+			std::pair{ "whitesmoke", 0xF5F5F5u },
+			std::pair{ "yellow", 0xFFFF00u },
+			std::pair{ "yellowgreen", 0x9ACD32u }
+		);
+		static_assert(namedColors.size() == 148);
+	}
+}
@@ -1,12 +1,14 @@
 #include "Parser.hpp"
+#include "CSSTables.hpp"
+
+#include <array>
+#include <cmath>
+#include <cctype>
+#include <charconv>
+#include <numbers>
 
 namespace Lucid {
 	namespace Parser {
-		std::map<std::string, glm::vec3> HTMLColors{
-			{"red", {1.0f, 0.0f, 0.0f}},
-			{"white", {1.0f, 1.0f, 1.0f}}
-		};
-
 		std::pair<std::string, std::string> OpenFiles(std::string htmlPath, std::string CSSPath)
 		{
 			std::ifstream htmlDocument(htmlPath);
@@ -32,47 +34,188 @@ namespace Lucid {
 		std::shared_ptr<HTMLElement> Parse(std::string htmlPath, std::string CSSPath)
 		{
 			auto files = OpenFiles(htmlPath, CSSPath);
-			std::string HTMLData = files.first;
-			std::string CSSData = files.second;
 
-			std::stack<std::shared_ptr<HTMLElement>> parsingStack;
-			std::shared_ptr<HTMLElement> root = std::make_shared<HTMLElement>();
+			std::shared_ptr<HTMLElement> root = ParseHTML(files.first);
+			processCSS(root, parseCSS(files.second));
+
+			return root;
+		}
+
+		// Moves the style attribute into the node's inline style
+		void takeInlineStyle(HTMLElement& node)
+		{
+			auto style = node.attributes.other.find("style");
+			if (style == node.attributes.other.end()) return;
+
+			node.inlineStyle = parseDeclarations(style->second);
+			node.attributes.other.erase(style);
+		}
+
+		static void setAttributes(HTMLAttributes& out, AttributeList attributes)
+		{
+			for (const AttributeView& attribute : attributes) {
+				if (attribute.name == "class") out.Class = attribute.value;
+				else if (attribute.name == "id") out.Id = attribute.value;
+				else out.other[std::string(attribute.name)] = attribute.value;
+			}
+		}
+
+		static HTMLElement& appendNode(HTMLElement& parent, std::string_view tagName, AttributeList attributes)
+		{
+			std::shared_ptr<HTMLElement> node = std::make_shared<HTMLElement>();
+			node->tagName = tagName;
+			setAttributes(node->attributes, attributes);
+			node->parent = &parent;
+			takeInlineStyle(*node);
+
+			parent.children.push_back(node);
+			return *node;
+		}
 
+		// Tags that never have content, so "<img src=a.png>" doesn't need the slash to be closed
+		static bool isVoidElement(std::string_view tagName)
+		{
+			return tagName == "img" || tagName == "br" || tagName == "hr" || tagName == "input" || tagName == "meta" || tagName == "link";
+		}
+
+		std::shared_ptr<HTMLElement> ParseHTML(const std::string& HTMLData)
+		{
+			std::shared_ptr<HTMLElement> root = std::make_shared<HTMLElement>();
 			root->tagName = "root";
-			parsingStack.push(root);
 
-			unsigned int currentIndex = 0;
+			std::vector<HTMLElement*> parsingStack = { root.get() };
+
+			SAXHandler builder;
+			builder.onOpen = [&](std::string_view tagName, AttributeList attributes) {
+				HTMLElement& node = appendNode(*parsingStack.back(), tagName, attributes);
+				if (!isVoidElement(tagName)) parsingStack.push_back(&node);
+			};
+			builder.onClose = [&](std::string_view tagName) {
+				if (parsingStack.size() > 1 && !isVoidElement(tagName))
+					parsingStack.pop_back();
+			};
+			builder.onSelfClosing = [&](std::string_view tagName, AttributeList attributes) {
+				appendNode(*parsingStack.back(), tagName, attributes);
+			};
+			builder.onText = [&](std::string_view text) {
+				parsingStack.back()->content += text;
+			};
+			ParseSAX(HTMLData, builder);
 
-			while (MoreTokens(HTMLData, currentIndex)) {
-				Token currentToken = getToken(HTMLData, currentIndex);
+			return root;
+		}
 
-				if (currentToken.type == Token::Opening) {
-					std::shared_ptr<HTMLElement> node = std::make_shared<HTMLElement>();
-					node->tagName = currentToken.tagName;
-					node->attributes = currentToken.attributes;
+		// A token as a view into the html, text is the tag name or the text content
+		struct TokenView {
+			Token::Type type = Token::Text;
+			std::string_view text;
+		};
 
-					parsingStack.top()->children.push_back(node);
-					parsingStack.push(node);
-				}
-				else if (currentToken.type == Token::Closing){
-					if (!parsingStack.empty()) 
-						parsingStack.pop();
+		static bool isSpace(char c)
+		{
+			return std::isspace(static_cast<unsigned char>(c)) != 0;
+		}
+
+		// Splits what is between the brackets of a tag into its name and attributes
+		static std::string_view splitTag(std::string_view inside, std::vector<AttributeView>& attributes)
+		{
+			size_t i = 0;
+			while (i < inside.size() && isSpace(inside[i])) ++i;
+			size_t nameStart = i;
+			while (i < inside.size() && !isSpace(inside[i])) ++i;
+			std::string_view tagName = inside.substr(nameStart, i - nameStart);
+
+			while (i < inside.size()) {
+				while (i < inside.size() && isSpace(inside[i])) ++i;
+				size_t start = i;
+				while (i < inside.size() && !isSpace(inside[i]) && inside[i] != '=') ++i;
+
+				// Attributes without a value are skipped
+				if (i >= inside.size() || inside[i] != '=') {
+					while (i < inside.size() && !isSpace(inside[i])) ++i;
+					continue;
 				}
-				else if (currentToken.type == Token::SelfClosing) {
-					std::shared_ptr<HTMLElement> node = std::make_shared<HTMLElement>();
-					node->tagName = currentToken.tagName;
-					node->attributes = currentToken.attributes;
 
-					parsingStack.top()->children.push_back(node);
+				std::string_view name = inside.substr(start, i - start);
+				++i; // skip '='
+
+				std::string_view value;
+				if (i < inside.size() && inside[i] == '"') {
+					// Quoted values may contain spaces (class lists, styles)
+					size_t close = inside.find('"', ++i);
+					if (close == std::string_view::npos) close = inside.size();
+					value = inside.substr(i, close - i);
+					i = close + 1;
 				}
 				else {
-					parsingStack.top()->content += currentToken.content;
+					size_t valueStart = i;
+					while (i < inside.size() && !isSpace(inside[i])) ++i;
+					value = inside.substr(valueStart, i - valueStart);
 				}
+				attributes.push_back({ name, value });
 			}
 
-			processCSS(root, parseCSS(CSSData));
+			return tagName;
+		}
 
-			return root;
+		// Reads the token at index and moves index past it. Returns false if only whitespace is left
+		static bool nextToken(std::string_view html, size_t& index, TokenView& token, std::vector<AttributeView>& attributes)
+		{
+			attributes.clear();
+
+			while (index < html.size() && isSpace(html[index])) ++index;
+			if (index >= html.size()) return false;
+
+			if (html[index] != '<') {
+				size_t end = html.find('<', index);
+				if (end == std::string_view::npos) end = html.size();
+				token = { Token::Text, html.substr(index, end - index) };
+				index = end;
+				return true;
+			}
+
+			++index;
+			size_t end = html.find('>', index);
+			if (end == std::string_view::npos) end = html.size();
+			std::string_view inside = html.substr(index, end - index);
+			index = std::min(end + 1, html.size());
+
+			if (!inside.empty() && inside.front() == '/') {
+				token = { Token::Closing, inside.substr(1) };
+			}
+			else if (!inside.empty() && inside.back() == '/') {
+				inside.remove_suffix(1);
+				token = { Token::SelfClosing, splitTag(inside, attributes) };
+			}
+			else {
+				token = { Token::Opening, splitTag(inside, attributes) };
+			}
+			return true;
+		}
+
+		void ParseSAX(std::string_view html, const SAXHandler& handler)
+		{
+			// Reused for every tag, so memory doesn't grow with the size of the page
+			std::vector<AttributeView> attributes;
+			TokenView token;
+
+			size_t index = 0;
+			while (nextToken(html, index, token, attributes)) {
+				switch (token.type) {
+				case Token::Opening:
+					if (handler.onOpen) handler.onOpen(token.text, attributes);
+					break;
+				case Token::Closing:
+					if (handler.onClose) handler.onClose(token.text);
+					break;
+				case Token::SelfClosing:
+					if (handler.onSelfClosing) handler.onSelfClosing(token.text, attributes);
+					break;
+				case Token::Text:
+					if (handler.onText) handler.onText(token.text);
+					break;
+				}
+			}
 		}
 
 		bool MoreTokens(const std::string& text, unsigned int index)
@@ -84,6 +227,22 @@ namespace Lucid {
 			return false;
 		}
 
+		// Written back the way parseSelector reads it, with the whitespace normalized
+		static std::string selectorText(const CSSSelector& selector)
+		{
+			std::string text;
+			for (size_t c = selector.compounds.size(); c-- > 0;) {
+				const CSSSelector::Compound& compound = selector.compounds[c];
+				if (compound.tag.empty() && compound.id.empty() && compound.classes.empty()) text += '*';
+				text += compound.tag;
+				if (!compound.id.empty()) text += '#' + compound.id;
+				for (const std::string& name : compound.classes) text += '.' + name;
+
+				if (c > 0) text += selector.combinators[c - 1] == CSSSelector::Combinator::Child ? " > " : " ";
+			}
+			return text;
+		}
+
 		std::vector<CSSRule> parseCSS(const std::string& css) {
 			std::vector<CSSRule> rules;
 
@@ -97,8 +256,7 @@ namespace Lucid {
 				while (i < css.size() && css[i] != '{') ++i;
 				if (i >= css.size()) break;
 
-				std::string selector = css.substr(selectorStart, i - selectorStart);
-				selector.erase(std::remove_if(selector.begin(), selector.end(), ::isspace), selector.end());
+				std::string selectors = css.substr(selectorStart, i - selectorStart);
 
 				++i; // skip '{'
 				size_t blockStart = i;
@@ -111,91 +269,699 @@ namespace Lucid {
 				++i; // skip '}'
 
 				// Parse block into key-value pairs
-				CSSRule rule;
-				rule.selector = selector;
+				std::map<std::string, std::string> properties = parseDeclarations(block);
+
+				// "h1, h2 { }" is one rule per selector
+				std::istringstream list(selectors);
+				std::string selector;
+				while (std::getline(list, selector, ',')) {
+					CSSRule rule;
+					rule.compiled = parseSelector(selector);
+					// Dropped if it uses something we can't match, as browsers do
+					if (rule.compiled.compounds.empty()) continue;
+					rule.selector = selectorText(rule.compiled);
+					rule.properties = properties;
+					rule.specificity = selectorSpecificity(rule.compiled);
+
+					rules.push_back(std::move(rule));
+				}
+			}
 
-				size_t j = 0;
-				while (j < block.size()) {
-					// Skip whitespace
-					while (j < block.size() && std::isspace(block[j])) ++j;
-					size_t keyStart = j;
+			// Applying rules in this order lets the more specific ones win, and the later ones among equals
+			std::stable_sort(rules.begin(), rules.end(), [](const CSSRule& a, const CSSRule& b) {
+				return a.specificity < b.specificity;
+			});
 
-					while (j < block.size() && block[j] != ':') ++j;
-					if (j >= block.size()) break;
+			return rules;
+		}
 
-					std::string key = block.substr(keyStart, j - keyStart);
-					key.erase(std::remove_if(key.begin(), key.end(), ::isspace), key.end());
+		std::map<std::string, std::string> parseDeclarations(const std::string& block)
+		{
+			std::map<std::string, std::string> properties;
+
+			size_t j = 0;
+			while (j < block.size()) {
+				// Skip whitespace
+				while (j < block.size() && std::isspace(block[j])) ++j;
+				size_t keyStart = j;
+
+				while (j < block.size() && block[j] != ':') ++j;
+				if (j >= block.size()) break;
+
+				std::string key = block.substr(keyStart, j - keyStart);
+				key.erase(std::remove_if(key.begin(), key.end(), ::isspace), key.end());
+
+				++j; // skip ':'
+				size_t valStart = j;
+
+				while (j < block.size() && block[j] != ';') ++j;
+				// Trim the value and collapse inner whitespace, shorthands like border need their parts kept apart
+				std::istringstream parts(block.substr(valStart, j - valStart));
+				std::string value, part;
+				while (parts >> part) {
+					if (!value.empty()) value += ' ';
+					value += part;
+				}
 
-					++j; // skip ':'
-					size_t valStart = j;
+				properties[key] = value;
+
+				if (j < block.size()) ++j; // skip ';'
+			}
+
+			return properties;
+		}
+
+		namespace {
+			// Interned strings, a deque so references handed out stay valid while it grows
+			std::mutex atomMutex;
+			std::deque<std::string> atomNames{ "" };
+			std::unordered_map<std::string, Atom> atoms{ { "", 0 } };
+		}
+
+		Atom internAtom(const std::string& text)
+		{
+			std::lock_guard<std::mutex> lock(atomMutex);
 
-					while (j < block.size() && block[j] != ';') ++j;
-					std::string value = block.substr(valStart, j - valStart);
-					value.erase(std::remove_if(value.begin(), value.end(), ::isspace), value.end());
+			auto it = atoms.find(text);
+			if (it != atoms.end()) return it->second;
 
-					rule.properties[key] = value;
+			// Out of handles, only a page with tens of thousands of distinct font names gets here
+			if (atomNames.size() > UINT16_MAX) return 0;
 
-					if (j < block.size()) ++j; // skip ';'
+			Atom atom = static_cast<Atom>(atomNames.size());
+			atomNames.push_back(text);
+			atoms.emplace(text, atom);
+			return atom;
+		}
+
+		const std::string& atomName(Atom atom)
+		{
+			std::lock_guard<std::mutex> lock(atomMutex);
+			return atom < atomNames.size() ? atomNames[atom] : atomNames[0];
+		}
+
+		uint32_t packColor(glm::vec4 color)
+		{
+			auto channel = [](float value) {
+				return static_cast<uint32_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+			};
+			return (channel(color.x) << 24) | (channel(color.y) << 16) | (channel(color.z) << 8) | channel(color.w);
+		}
+
+		glm::vec4 unpackColor(uint32_t color)
+		{
+			auto channel = [color](int shift) {
+				return static_cast<float>((color >> shift) & 0xFF) / 255.0f;
+			};
+			return glm::vec4(channel(24), channel(16), channel(8), channel(0));
+		}
+
+		static std::string_view trimmed(std::string_view text)
+		{
+			size_t first = text.find_first_not_of(" \t\r\n");
+			if (first == std::string_view::npos) return {};
+			return text.substr(first, text.find_last_not_of(" \t\r\n") - first + 1);
+		}
+
+		// Css names are case insensitive, the tables hold them in lower case. Returns an empty view if the name doesn't fit
+		static std::string_view lowered(std::string_view text, std::array<char, 32>& buffer)
+		{
+			if (text.size() > buffer.size()) return {};
+			for (size_t i = 0; i < text.size(); ++i) {
+				buffer[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(text[i])));
+			}
+			return std::string_view(buffer.data(), text.size());
+		}
+
+		static uint8_t channel(float value)
+		{
+			return static_cast<uint8_t>(std::clamp(value, 0.0f, 255.0f) + 0.5f);
+		}
+
+		// #rgb, #rgba, #rrggbb and #rrggbbaa, without the #
+		static bool parseHexColor(std::string_view hex, uint32_t& color)
+		{
+			uint32_t digits = 0;
+			for (char c : hex) {
+				int digit = std::isdigit(static_cast<unsigned char>(c)) ? c - '0' : std::tolower(static_cast<unsigned char>(c)) - 'a' + 10;
+				if (digit < 0 || digit > 15) return false;
+				digits = (digits << 4) | static_cast<uint32_t>(digit);
+			}
+
+			switch (hex.size()) {
+			case 3:
+			case 4: {
+				// Every digit is doubled, 0xf becomes 0xff
+				uint32_t expanded = 0;
+				for (size_t i = 0; i < hex.size(); ++i) {
+					expanded |= (((digits >> (i * 4)) & 0xF) * 0x11) << (i * 8);
 				}
+				color = hex.size() == 3 ? (expanded << 8) | 0xFF : expanded;
+				return true;
+			}
+			case 6:
+				color = (digits << 8) | 0xFF;
+				return true;
+			case 8:
+				color = digits;
+				return true;
+			default:
+				return false;
+			}
+		}
 
-				rules.push_back(rule);
+		struct ColorArgument {
+			float value = 0.0f;
+			std::string_view unit; // "%", "deg", "turn" and so on, empty for plain numbers
+		};
+
+		// The arguments of rgb() and hsl(), separated by commas, spaces or the slash before the alpha
+		static size_t parseColorArguments(std::string_view text, std::array<ColorArgument, 4>& arguments)
+		{
+			size_t count = 0;
+			const char* position = text.data();
+			const char* end = text.data() + text.size();
+			while (position < end) {
+				if (std::isspace(static_cast<unsigned char>(*position)) || *position == ',' || *position == '/') {
+					++position;
+					continue;
+				}
+				if (count == arguments.size()) return 0;
+
+				ColorArgument& argument = arguments[count++];
+				if (*position == '+') ++position;
+				auto [next, error] = std::from_chars(position, end, argument.value);
+				if (error != std::errc()) return 0;
+
+				position = next;
+				while (position < end && (std::isalpha(static_cast<unsigned char>(*position)) || *position == '%')) ++position;
+				argument.unit = std::string_view(next, position - next);
 			}
+			return count;
+		}
 
-			return rules;
+		static float alphaOf(const ColorArgument& argument)
+		{
+			return std::clamp(argument.unit == "%" ? argument.value / 100.0f : argument.value, 0.0f, 1.0f);
+		}
+
+		static uint32_t rgbColor(const std::array<ColorArgument, 4>& arguments, size_t count)
+		{
+			uint32_t color = 0;
+			for (size_t i = 0; i < 3; ++i) {
+				float value = arguments[i].unit == "%" ? arguments[i].value * 2.55f : arguments[i].value;
+				color = (color << 8) | channel(value);
+			}
+			return (color << 8) | channel(count == 4 ? alphaOf(arguments[3]) * 255.0f : 255.0f);
+		}
+
+		static uint32_t hslColor(const std::array<ColorArgument, 4>& arguments, size_t count)
+		{
+			float hue = arguments[0].value;
+			if (arguments[0].unit == "turn") hue *= 360.0f;
+			else if (arguments[0].unit == "rad") hue *= 180.0f / std::numbers::pi_v<float>;
+			else if (arguments[0].unit == "grad") hue *= 0.9f;
+			hue = std::fmod(std::fmod(hue, 360.0f) + 360.0f, 360.0f);
+
+			float saturation = std::clamp(arguments[1].value / 100.0f, 0.0f, 1.0f);
+			float lightness = std::clamp(arguments[2].value / 100.0f, 0.0f, 1.0f);
+
+			// As in the css color spec
+			auto component = [&](float n) {
+				float k = std::fmod(n + hue / 30.0f, 12.0f);
+				float a = saturation * std::min(lightness, 1.0f - lightness);
+				return lightness - a * std::max(-1.0f, std::min({ k - 3.0f, 9.0f - k, 1.0f }));
+			};
+
+			uint32_t color = (uint32_t(channel(component(0.0f) * 255.0f)) << 24) | (uint32_t(channel(component(8.0f) * 255.0f)) << 16) |
+				(uint32_t(channel(component(4.0f) * 255.0f)) << 8);
+			return color | channel(count == 4 ? alphaOf(arguments[3]) * 255.0f : 255.0f);
+		}
+
+		uint32_t parseColor(std::string_view value)
+		{
+			constexpr uint32_t black = 0x000000FF; // unknown colors
+			value = trimmed(value);
+			if (value.empty()) return black;
+
+			uint32_t color = black;
+			if (value.front() == '#') {
+				return parseHexColor(value.substr(1), color) ? color : black;
+			}
+
+			std::array<char, 32> buffer;
+			size_t open = value.find('(');
+			if (open != std::string_view::npos) {
+				std::string_view function = lowered(trimmed(value.substr(0, open)), buffer);
+				if (value.back() != ')') return black;
+
+				std::array<ColorArgument, 4> arguments;
+				size_t count = parseColorArguments(value.substr(open + 1, value.size() - open - 2), arguments);
+				if (count < 3) return black;
+
+				if (function == "rgb" || function == "rgba") return rgbColor(arguments, count);
+				if (function == "hsl" || function == "hsla") return hslColor(arguments, count);
+				return black;
+			}
+
+			std::string_view name = lowered(value, buffer);
+			if (const uint32_t* named = namedColors.find(name)) return (*named << 8) | 0xFF;
+			if (const Keyword* keyword = keywords.find(name); keyword && *keyword == Keyword::Transparent) return 0;
+			return black;
+		}
+
+		CSSEdges parseEdges(const std::string& value)
+		{
+			std::vector<float> lengths;
+			std::istringstream parts(value);
+			std::string part;
+			while (lengths.size() < 4 && parts >> part) {
+				lengths.push_back(static_cast<float>(std::atof(part.c_str())));
+			}
+
+			// top right bottom left, missing sides copy their opposite
+			CSSEdges edges;
+			if (lengths.empty()) return edges;
+			edges.top = lengths[0];
+			edges.right = lengths.size() > 1 ? lengths[1] : edges.top;
+			edges.bottom = lengths.size() > 2 ? lengths[2] : edges.top;
+			edges.left = lengths.size() > 3 ? lengths[3] : edges.right;
+			return edges;
+		}
+
+		uint16_t parseFontWeight(std::string_view value)
+		{
+			std::array<char, 32> buffer;
+			if (const Keyword* keyword = keywords.find(lowered(trimmed(value), buffer))) {
+				switch (*keyword) {
+				case Keyword::Bold:
+				case Keyword::Bolder: return 700;
+				case Keyword::Lighter: return 100;
+				default: return 400;
+				}
+			}
+
+			int weight = std::atoi(std::string(value).c_str());
+			return static_cast<uint16_t>(weight > 0 ? std::clamp(weight, 1, 1000) : 400);
+		}
+
+		// border: <width> <style> <color>, in any order and each part optional
+		void parseBorder(const std::string& value, CSSProperties& outProps)
+		{
+			std::istringstream parts(value);
+			std::string part;
+			std::array<char, 32> buffer;
+			while (parts >> part) {
+				if (std::isdigit(static_cast<unsigned char>(part.front())) || part.front() == '.') {
+					outProps.cold.borderWidth = std::atof(part.c_str());
+					continue;
+				}
+
+				const Keyword* keyword = keywords.find(lowered(part, buffer));
+				if (!keyword || *keyword == Keyword::Transparent) {
+					outProps.cold.borderColor = parseColor(part);
+					continue;
+				}
+
+				switch (*keyword) {
+				case Keyword::None:
+				case Keyword::Hidden: outProps.cold.borderWidth = 0.0f; break;
+				case Keyword::Thin: outProps.cold.borderWidth = 1.0f; break;
+				case Keyword::Medium: outProps.cold.borderWidth = 3.0f; break;
+				case Keyword::Thick: outProps.cold.borderWidth = 5.0f; break;
+				default: break; // the other styles are drawn solid
+				}
+			}
+		}
+
+		static uint16_t propertyBit(PropertyName name)
+		{
+			using Property = CSSProperties::Property;
+			switch (name) {
+			case PropertyName::Color: return Property::Color;
+			case PropertyName::FontSize: return Property::FontSize;
+			case PropertyName::FontFamily: return Property::FontFamily;
+			case PropertyName::FontWeight: return Property::FontWeight;
+			case PropertyName::Background:
+			case PropertyName::BackgroundColor: return Property::Background;
+			case PropertyName::Top: return Property::Top;
+			case PropertyName::Left: return Property::Left;
+			case PropertyName::Width: return Property::Width;
+			case PropertyName::Height: return Property::Height;
+			case PropertyName::Border:
+			case PropertyName::BorderWidth:
+			case PropertyName::BorderColor:
+			case PropertyName::BorderRadius: return Property::Border;
+			case PropertyName::Padding: return Property::Padding;
+			case PropertyName::Margin: return Property::Margin;
+			}
+			return 0;
 		}
 
 		void applyCSSProperties(const std::map<std::string, std::string>& ruleProps, CSSProperties& outProps) {
 			for (const auto& [key, value] : ruleProps) {
-				if (key == "color") outProps.color = glm::vec4(HTMLColors[value], 1.0f);
-				else if (key == "font-size") outProps.fontSize = std::atoi(value.c_str());
-				else if (key == "background") outProps.background = glm::vec4(HTMLColors[value], 1.0f);
-				else if (key == "padding") outProps.padding = value;
-				else if (key == "margin") outProps.margin = value;
-				else if (key == "font-weight") outProps.fontWeight = value;
-				else if (key == "font-family") outProps.fontfamily = (value.empty()) ? "Arial" : value;
-				else if (key == "top") outProps.position.y = std::atof(value.c_str());
-				else if (key == "left") outProps.position.x = std::atof(value.c_str());
+				const PropertyName* name = propertyNames.find(key);
+				if (!name) continue;
+
+				switch (*name) {
+				case PropertyName::Color: outProps.color = parseColor(value); break;
+				case PropertyName::FontSize: outProps.fontSize = static_cast<uint16_t>(std::atoi(value.c_str())); break;
+				case PropertyName::Background:
+				case PropertyName::BackgroundColor: outProps.background = parseColor(value); break;
+				case PropertyName::Border: parseBorder(value, outProps); break;
+				case PropertyName::BorderWidth: outProps.cold.borderWidth = std::atof(value.c_str()); break;
+				case PropertyName::BorderColor: outProps.cold.borderColor = parseColor(value); break;
+				case PropertyName::BorderRadius: outProps.cold.borderRadius = std::atof(value.c_str()); break;
+				case PropertyName::Padding: outProps.cold.padding = parseEdges(value); break;
+				case PropertyName::Margin: outProps.cold.margin = parseEdges(value); break;
+				case PropertyName::FontWeight: outProps.cold.fontWeight = parseFontWeight(value); break;
+				case PropertyName::FontFamily: outProps.fontFamily = internAtom((value.empty()) ? "Arial" : value); break;
+				case PropertyName::Top: outProps.position.y = std::atof(value.c_str()); break;
+				case PropertyName::Left: outProps.position.x = std::atof(value.c_str()); break;
+				case PropertyName::Width: outProps.size.x = std::atof(value.c_str()); break;
+				case PropertyName::Height: outProps.size.y = std::atof(value.c_str()); break;
+				}
+
+				outProps.specified |= propertyBit(*name);
 				// extend for more props
 			}
 		}
 
-		void applyCSSRulesToNode(std::shared_ptr<HTMLElement>& node, const std::vector<CSSRule>& cssRules) {
-			for (const auto& rule : cssRules) {
-				const std::string& sel = rule.selector;
-				bool matches = false;
-
-				// Match by tag name
-				if (sel == node->tagName) matches = true;
-
-				// Match by id
-				else if (!node->attributes.Id.empty() && sel == "#" + node->attributes.Id) matches = true;
-
-				// Match by class (supports multiple classes split by space)
-				else if (!node->attributes.Class.empty()) {
-					std::istringstream ss(node->attributes.Class);
-					std::string cls;
-					while (ss >> cls) {
-						if (sel == "." + cls) {
-							matches = true;
-							break;
-						}
-					}
+		static bool isIdentifier(char c)
+		{
+			return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_';
+		}
+
+		// FNV-1a over the name, salted with the kind of part ('t', '#' or '.') so a tag and a class of the same name differ
+		static uint32_t partHash(char kind, std::string_view name)
+		{
+			uint32_t hash = (2166136261u ^ static_cast<unsigned char>(kind)) * 16777619u;
+			for (char c : name) hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+			return hash;
+		}
+
+		static bool hasClass(std::string_view classList, std::string_view name)
+		{
+			size_t i = 0;
+			while (i < classList.size()) {
+				while (i < classList.size() && isSpace(classList[i])) ++i;
+				size_t start = i;
+				while (i < classList.size() && !isSpace(classList[i])) ++i;
+				if (i > start && classList.substr(start, i - start) == name) return true;
+			}
+			return false;
+		}
+
+		template<typename Callback>
+		static void forEachClass(std::string_view classList, Callback callback)
+		{
+			size_t i = 0;
+			while (i < classList.size()) {
+				while (i < classList.size() && isSpace(classList[i])) ++i;
+				size_t start = i;
+				while (i < classList.size() && !isSpace(classList[i])) ++i;
+				if (i > start) callback(classList.substr(start, i - start));
+			}
+		}
+
+		CSSSelector parseSelector(std::string_view text)
+		{
+			CSSSelector selector;
+			// Read left to right, reversed at the end
+			std::vector<CSSSelector::Compound> compounds;
+			std::vector<CSSSelector::Combinator> combinators;
+
+			size_t i = 0;
+			auto readName = [&]() {
+				size_t start = i;
+				while (i < text.size() && isIdentifier(text[i])) ++i;
+				return std::string(text.substr(start, i - start));
+			};
+
+			while (true) {
+				bool space = false;
+				while (i < text.size() && isSpace(text[i])) { ++i; space = true; }
+				if (i >= text.size()) break;
+
+				if (text[i] == '>') {
+					++i;
+					if (compounds.empty() || combinators.size() == compounds.size()) return {};
+					combinators.push_back(CSSSelector::Combinator::Child);
+					continue;
 				}
+				if (!compounds.empty() && combinators.size() < compounds.size()) {
+					if (!space) return {};
+					combinators.push_back(CSSSelector::Combinator::Descendant);
+				}
+
+				CSSSelector::Compound compound;
+				if (text[i] == '*') ++i;
+				else if (isIdentifier(text[i])) compound.tag = readName();
 
-				if (matches) {
-					applyCSSProperties(rule.properties, node->properties);
+				while (i < text.size() && (text[i] == '#' || text[i] == '.')) {
+					char kind = text[i++];
+					std::string name = readName();
+					if (name.empty()) return {};
+					if (kind == '#') compound.id = std::move(name);
+					else compound.classes.push_back(std::move(name));
 				}
+
+				// Pseudo classes, attribute selectors and the sibling combinators are not supported
+				if (i < text.size() && !isSpace(text[i]) && text[i] != '>') return {};
+				compounds.push_back(std::move(compound));
+			}
+			if (compounds.empty() || combinators.size() != compounds.size() - 1) return {};
+
+			selector.compounds.assign(compounds.rbegin(), compounds.rend());
+			selector.combinators.assign(combinators.rbegin(), combinators.rend());
+
+			// Ids and classes are the most selective, tags come last
+			auto addHash = [&](uint32_t hash) {
+				if (selector.ancestorHashCount < selector.ancestorHashes.size()) selector.ancestorHashes[selector.ancestorHashCount++] = hash;
+			};
+			for (size_t c = 1; c < selector.compounds.size(); ++c) {
+				if (!selector.compounds[c].id.empty()) addHash(partHash('#', selector.compounds[c].id));
+			}
+			for (size_t c = 1; c < selector.compounds.size(); ++c) {
+				for (const std::string& name : selector.compounds[c].classes) addHash(partHash('.', name));
+			}
+			for (size_t c = 1; c < selector.compounds.size(); ++c) {
+				if (!selector.compounds[c].tag.empty()) addHash(partHash('t', selector.compounds[c].tag));
+			}
+
+			return selector;
+		}
+
+		unsigned int selectorSpecificity(const CSSSelector& selector)
+		{
+			unsigned int specificity = 0;
+			for (const CSSSelector::Compound& compound : selector.compounds) {
+				if (!compound.id.empty()) specificity += 10000;
+				specificity += 100 * static_cast<unsigned int>(compound.classes.size());
+				if (!compound.tag.empty()) specificity += 1;
 			}
+			return specificity;
+		}
+
+		unsigned int selectorSpecificity(const std::string& selector)
+		{
+			return selectorSpecificity(parseSelector(selector));
+		}
+
+		static bool compoundMatches(const CSSSelector::Compound& compound, const HTMLElement& node)
+		{
+			if (!compound.tag.empty() && compound.tag != node.tagName) return false;
+			if (!compound.id.empty() && compound.id != node.attributes.Id) return false;
+			for (const std::string& name : compound.classes) {
+				if (!hasClass(node.attributes.Class, name)) return false;
+			}
+			return true;
+		}
+
+		// element matched compounds[index - 1], finds ancestors for the rest
+		static bool ancestorsMatch(const CSSSelector& selector, size_t index, const HTMLElement& element)
+		{
+			if (index == selector.compounds.size()) return true;
+
+			const HTMLElement* ancestor = element.parent;
+			if (selector.combinators[index - 1] == CSSSelector::Combinator::Child) {
+				return ancestor && compoundMatches(selector.compounds[index], *ancestor) && ancestorsMatch(selector, index + 1, *ancestor);
+			}
+
+			for (; ancestor; ancestor = ancestor->parent) {
+				if (compoundMatches(selector.compounds[index], *ancestor) && ancestorsMatch(selector, index + 1, *ancestor)) return true;
+			}
+			return false;
+		}
+
+		bool selectorMatches(const CSSSelector& selector, const HTMLElement& node, const AncestorFilter* filter)
+		{
+			if (selector.compounds.empty() || !compoundMatches(selector.compounds.front(), node)) return false;
+			if (selector.compounds.size() == 1) return true;
+
+			if (filter && !filter->MayMatch(selector)) return false;
+			return ancestorsMatch(selector, 1, node);
+		}
+
+		bool selectorMatches(const std::string& selector, const HTMLElement& node)
+		{
+			return selectorMatches(parseSelector(selector), node);
+		}
+
+		bool hasCombinators(const std::vector<CSSRule>& cssRules)
+		{
+			return std::any_of(cssRules.begin(), cssRules.end(), [](const CSSRule& rule) { return rule.compiled.compounds.size() > 1; });
+		}
+
+		void AncestorFilter::Add(uint32_t hash, int delta)
+		{
+			constexpr uint32_t mask = (1u << Bits) - 1;
+			for (uint32_t index : { hash & mask, (hash >> Bits) & mask }) {
+				uint8_t& counter = counters[index];
+				if (counter == UINT8_MAX) continue;
+				counter = static_cast<uint8_t>(counter + delta);
+			}
+		}
+
+		void AncestorFilter::Push(const HTMLElement& node)
+		{
+			Add(partHash('t', node.tagName), 1);
+			if (!node.attributes.Id.empty()) Add(partHash('#', node.attributes.Id), 1);
+			forEachClass(node.attributes.Class, [&](std::string_view name) { Add(partHash('.', name), 1); });
+		}
+
+		void AncestorFilter::Pop(const HTMLElement& node)
+		{
+			Add(partHash('t', node.tagName), -1);
+			if (!node.attributes.Id.empty()) Add(partHash('#', node.attributes.Id), -1);
+			forEachClass(node.attributes.Class, [&](std::string_view name) { Add(partHash('.', name), -1); });
+		}
+
+		void AncestorFilter::PushAncestors(const HTMLElement& node)
+		{
+			for (const HTMLElement* ancestor = node.parent; ancestor; ancestor = ancestor->parent) Push(*ancestor);
+		}
+
+		bool AncestorFilter::MayMatch(const CSSSelector& selector) const
+		{
+			constexpr uint32_t mask = (1u << Bits) - 1;
+			for (uint8_t i = 0; i < selector.ancestorHashCount; ++i) {
+				uint32_t hash = selector.ancestorHashes[i];
+				if (counters[hash & mask] == 0 || counters[(hash >> Bits) & mask] == 0) return false;
+			}
+			return true;
+		}
+
+		CSSProperties inheritedProperties(const CSSProperties* parent)
+		{
+			CSSProperties properties;
+			if (!parent) return properties;
+
+			constexpr uint16_t inherited = CSSProperties::Color | CSSProperties::FontSize | CSSProperties::FontFamily | CSSProperties::FontWeight;
+
+			properties.color = parent->color;
+			properties.fontSize = parent->fontSize;
+			properties.fontFamily = parent->fontFamily;
+			properties.cold.fontWeight = parent->cold.fontWeight;
+			properties.specified = parent->specified & inherited;
+			return properties;
+		}
+
+		CSSProperties computeStyle(const HTMLElement& node, const std::vector<CSSRule>& cssRules, const AncestorFilter* filter)
+		{
+			CSSProperties properties = inheritedProperties(node.parent ? node.parent->style.get() : nullptr);
+
+			for (const auto& rule : cssRules) {
+				if (selectorMatches(rule.compiled, node, filter)) applyCSSProperties(rule.properties, properties);
+			}
+			applyCSSProperties(node.inlineStyle, properties);
+
+			return properties;
+		}
+
+		const CSSProperties& HTMLElement::properties() const
+		{
+			static const CSSProperties defaults;
+			return style ? *style : defaults;
+		}
+
+		size_t StyleCache::KeyHash::operator()(const Key& key) const
+		{
+			size_t hash = std::hash<const void*>()(key.parent.get());
+			hash ^= std::hash<std::string>()(key.tagName) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+			hash ^= std::hash<std::string>()(key.Class) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+			return hash;
+		}
+
+		std::shared_ptr<const CSSProperties> StyleCache::Get(const HTMLElement& node, const std::vector<CSSRule>& cssRules, const AncestorFilter* filter)
+		{
+			// An id or inline style makes the node's style its own
+			if (!node.attributes.Id.empty() || !node.inlineStyle.empty()) {
+				++misses;
+				return std::make_shared<const CSSProperties>(computeStyle(node, cssRules, filter));
+			}
+
+			Key key{ node.parent ? node.parent->style : nullptr, node.tagName, node.attributes.Class };
+			auto it = styles.find(key);
+			if (it != styles.end()) {
+				++hits;
+				return it->second;
+			}
+
+			++misses;
+			auto style = std::make_shared<const CSSProperties>(computeStyle(node, cssRules, filter));
+			styles.emplace(std::move(key), style);
+			return style;
+		}
+
+		void StyleCache::Clear()
+		{
+			styles.clear();
+			hits = 0;
+			misses = 0;
+		}
+
+		MemoryStats::Usage StyleCache::GetMemoryUsage() const
+		{
+			MemoryStats::Usage usage{ styles.size(), MemoryStats::HashMapBytes(styles) };
+			for (const auto& [key, style] : styles) usage.bytes += MemoryStats::StringBytes(key.tagName) + MemoryStats::StringBytes(key.Class);
+			return usage;
+		}
+
+		void restyleNode(HTMLElement& node, const std::vector<CSSRule>& cssRules)
+		{
+			node.style = std::make_shared<const CSSProperties>(computeStyle(node, cssRules));
+		}
+
+		void restyleNode(HTMLElement& node, const std::vector<CSSRule>& cssRules, StyleCache& cache, const AncestorFilter* filter)
+		{
+			node.style = cache.Get(node, cssRules, filter);
 		}
 
 		void processCSS(std::shared_ptr<HTMLElement>& root, const std::vector<CSSRule>& cssRules) {
 			if (!root) return;
 
-			applyCSSRulesToNode(root, cssRules);
+			StyleCache cache;
+			processCSS(*root, cssRules, cache);
+		}
 
-			for (auto& child : root->children) {
-				processCSS(child, cssRules);
+		static void processTree(HTMLElement& node, const std::vector<CSSRule>& cssRules, StyleCache& cache, AncestorFilter& filter)
+		{
+			restyleNode(node, cssRules, cache, &filter);
+			if (node.children.empty()) return;
+
+			filter.Push(node);
+			for (auto& child : node.children) {
+				processTree(*child, cssRules, cache, filter);
 			}
+			filter.Pop(node);
+		}
+
+		void processCSS(HTMLElement& node, const std::vector<CSSRule>& cssRules, StyleCache& cache)
+		{
+			AncestorFilter filter;
+			filter.PushAncestors(node);
+			processTree(node, cssRules, cache, filter);
 		}
 
 		void debug(const std::shared_ptr<HTMLElement>& node, int depth)
@@ -216,62 +982,20 @@ namespace Lucid {
 		Token getToken(const std::string& html, unsigned int& index) {
 			Token token;
 
-			// Skip whitespace
-			while (index < html.size() && std::isspace(html[index])) {
-				++index;
+			std::vector<AttributeView> attributes;
+			TokenView view;
+			size_t position = index;
+			if (!nextToken(html, position, view, attributes)) {
+				token.type = Token::Text;
+				index = static_cast<unsigned int>(position);
+				return token;
 			}
+			index = static_cast<unsigned int>(position);
 
-			if (html[index] == '<') {
-				// It's a tag
-				++index;
-				if (html[index] == '/') {
-					// Closing tag
-					++index;
-					size_t end = html.find('>', index);
-					token.type = Token::Type::Closing;
-					token.tagName = html.substr(index, end - index);
-					index = end + 1;
-				}
-				else {
-					// Opening or self-closing tag
-					size_t end = html.find('>', index);
-					bool selfClosing = html[end - 1] == '/';
-
-					std::string inside = html.substr(index, end - index);
-					index = end + 1;
-
-					// Remove trailing slash if self-closing
-					if (selfClosing && inside.back() == '/') {
-						inside.pop_back();
-					}
-
-					// Split into tag name and attributes
-					std::istringstream ss(inside);
-					ss >> token.tagName;
-					std::string attr;
-					while (ss >> attr) {
-						size_t eq = attr.find('=');
-						if (eq != std::string::npos) {
-							std::string key = attr.substr(0, eq);
-							std::string val = attr.substr(eq + 1);
-							val.erase(std::remove(val.begin(), val.end(), '"'), val.end());
-							if (key == "class") token.attributes.Class = val;
-							else if (key == "id") token.attributes.Id = val;
-							else std::cout << key << ": " << val << std::endl;
-						}
-					}
-
-					token.type = selfClosing ? Token::Type::SelfClosing : Token::Type::Opening;
-				}
-			}
-			else {
-				// It's text content
-				size_t end = html.find('<', index);
-				if (end == std::string::npos) end = html.size();
-				token.type = Token::Type::Text;
-				token.content = html.substr(index, end - index);
-				index = end;
-			}
+			token.type = view.type;
+			if (view.type == Token::Text) token.content = view.text;
+			else token.tagName = view.text;
+			setAttributes(token.attributes, attributes);
 
 			return token;
 		}
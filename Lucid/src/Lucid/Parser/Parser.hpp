@@ -7,27 +7,88 @@
 #include <vector>
 #include <stack>
 #include <string>
+#include <string_view>
+#include <span>
+#include <array>
 #include <thread>
 #include <map>
+#include <deque>
+#include <mutex>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
 
 #include <glm/glm.hpp>
 
+#include "../Memory/MemoryStats.hpp"
+
 namespace Lucid {
 	namespace Parser {
 		struct HTMLAttributes {
 			std::string Class;
 			std::string Id;
+			std::map<std::string, std::string> other;
+
+			bool operator==(const HTMLAttributes& other) const = default;
 		};
+		// Interned string handle, the same text always gets the same atom. Atom 0 is the empty string
+		using Atom = uint16_t;
+
+		// Colors are packed as 0xRRGGBBAA
+		uint32_t packColor(glm::vec4 color);
+		glm::vec4 unpackColor(uint32_t color);
+
+		struct CSSEdges {
+			float top = 0.0f;
+			float right = 0.0f;
+			float bottom = 0.0f;
+			float left = 0.0f;
+
+			bool operator==(const CSSEdges& other) const = default;
+		};
+
 		struct CSSProperties {
-			glm::vec4 color;
-			unsigned int fontSize;
-			glm::vec4 background;
-			glm::vec2 position;
-			std::string fontfamily;
-			std::string padding;
-			std::string margin;
-			std::string fontWeight;
-			// Add more as needed
+			// Which properties were given by a rule, an inline style or inherited
+			enum Property : uint16_t {
+				Color = 1 << 0,
+				FontSize = 1 << 1,
+				FontFamily = 1 << 2,
+				FontWeight = 1 << 3,
+				Background = 1 << 4,
+				Top = 1 << 5,
+				Left = 1 << 6,
+				Width = 1 << 7,
+				Height = 1 << 8,
+				Border = 1 << 9,
+				Padding = 1 << 10,
+				Margin = 1 << 11
+			};
+
+			// Hot, read for every element by layout, hit testing and painting. Fits in 32 bytes
+			glm::vec2 position{};
+			glm::vec2 size{}; // only meaningful with the Width and Height bits set
+			uint32_t color = 0;
+			uint32_t background = 0;
+			uint16_t fontSize = 0;
+			Atom fontFamily = 0;
+			uint16_t specified = 0; // Property bits
+
+			// Cold, only looked at for elements that draw a box or by the application
+			struct Cold {
+				uint32_t borderColor = 0;
+				float borderWidth = 0.0f;
+				float borderRadius = 0.0f;
+				CSSEdges padding;
+				CSSEdges margin;
+				uint16_t fontWeight = 400;
+
+				bool operator==(const Cold& other) const = default;
+			} cold;
+
+			bool has(Property property) const { return (specified & property) != 0; }
+
+			bool operator==(const CSSProperties& other) const = default;
 		};
 		struct Token {
 			enum Type {
@@ -41,31 +102,180 @@ namespace Lucid {
 			std::string content;
 		};
 
+		// An attribute as written in the tag, without the quotes. Points into the html being parsed
+		struct AttributeView {
+			std::string_view name;
+			std::string_view value;
+		};
+		using AttributeList = std::span<const AttributeView>;
+
+		// Callbacks for ParseSAX, any of them can be left empty.
+		// The views are only valid during the call, copy what has to be kept
+		struct SAXHandler {
+			std::function<void(std::string_view tagName, AttributeList attributes)> onOpen;
+			std::function<void(std::string_view tagName)> onClose;
+			std::function<void(std::string_view tagName, AttributeList attributes)> onSelfClosing;
+			std::function<void(std::string_view text)> onText;
+		};
+
 		struct HTMLElement {
+			enum Dirty : unsigned char {
+				Clean = 0,
+				DirtyStyle = 1 << 0,
+				DirtyLayout = 1 << 1
+			};
+
 			std::string tagName;
 			HTMLAttributes attributes;
-			CSSProperties properties;
+			// Computed style, immutable and possibly shared with other nodes, replace it instead of changing it
+			std::shared_ptr<const CSSProperties> style;
+			std::map<std::string, std::string> inlineStyle; // from the style attribute or set at runtime, wins over the css rules
 			std::vector<std::shared_ptr<HTMLElement>> children;
+			HTMLElement* parent = nullptr;
 			std::string content; // could be text, a link, etc.
+			int renderIndex = -1; // index of the element created for this node when the page is loaded
+			int imageIndex = -1;  // same for the image element of an img node
+			unsigned char dirty = Clean; // what needs recomputing before the next draw
+
+			// Defaults if the node has not been styled yet
+			const CSSProperties& properties() const;
+		};
+
+		// A selector split into compound selectors, read from right to left: compounds[0] is matched against the
+		// element itself and combinators[i] says how compounds[i + 1] relates to the element matching compounds[i]
+		struct CSSSelector {
+			// A tag, id and classes that all have to match the same element, empty parts match anything
+			struct Compound {
+				std::string tag;
+				std::string id;
+				std::vector<std::string> classes;
+			};
+			enum class Combinator : uint8_t {
+				Descendant, // "a b"
+				Child       // "a > b"
+			};
+
+			std::vector<Compound> compounds; // empty if the selector couldn't be parsed, it matches nothing then
+			std::vector<Combinator> combinators;
+			// Hashes of parts the ancestors must have, for AncestorFilter. Only the first few are kept
+			std::array<uint32_t, 4> ancestorHashes{};
+			uint8_t ancestorHashCount = 0;
+
+			bool operator==(const CSSSelector& other) const = default;
 		};
 
 		struct CSSRule {
-			std::string selector;
+			std::string selector; // normalized, "div > p.note"
+			CSSSelector compiled;
 			std::map<std::string, std::string> properties;
+			unsigned int specificity = 0;
+		};
+
+		// Counting Bloom filter over the tags, ids and classes of the ancestors of the node being styled.
+		// A selector needing an ancestor part that is not in the filter can't match, so most descendant and
+		// child selectors are rejected without walking up the tree. Push a node before styling its children
+		// and pop it after, false positives only cost the walk
+		class AncestorFilter {
+		public:
+			void Push(const HTMLElement& node);
+			void Pop(const HTMLElement& node);
+			// Pushes the ancestors of node, for styling a subtree in the middle of the tree
+			void PushAncestors(const HTMLElement& node);
+
+			// False if the selector surely doesn't match under the pushed ancestors
+			bool MayMatch(const CSSSelector& selector) const;
+
+		private:
+			static constexpr uint32_t Bits = 12;
+
+			void Add(uint32_t hash, int delta);
+
+			// Saturated counters stay at the maximum, the filter only gets less precise
+			std::array<uint8_t, 1 << Bits> counters{};
+		};
+
+		// Hands out one shared computed style to nodes that are bound to get the same one: nodes with the same
+		// parent style, tag and class and without an id or inline style of their own.
+		// Shared styles are keyed by their parent's style and styles with an id are never shared, so the parent's
+		// style stands for the tags, ids and classes of all the ancestors, which descendant and child selectors look at.
+		// Styles stay alive while they are cached, clear the cache when the rules change
+		class StyleCache {
+		public:
+			// Returns the computed style for the node, from the cache if it can be shared
+			std::shared_ptr<const CSSProperties> Get(const HTMLElement& node, const std::vector<CSSRule>& cssRules, const AncestorFilter* filter = nullptr);
+			void Clear();
+
+			/* ---Getters--- */
+			size_t Size() const { return styles.size(); }
+			size_t Hits() const { return hits; }
+			size_t Misses() const { return misses; }
+			// Entries and their keys, the styles are counted with the nodes that use them
+			MemoryStats::Usage GetMemoryUsage() const;
+
+		private:
+			struct Key {
+				// Owning, so the parent's address can't be reused by another style while it is a key
+				std::shared_ptr<const CSSProperties> parent;
+				std::string tagName;
+				std::string Class;
+
+				bool operator==(const Key& other) const = default;
+			};
+			struct KeyHash {
+				size_t operator()(const Key& key) const;
+			};
+
+			std::unordered_map<Key, std::shared_ptr<const CSSProperties>, KeyHash> styles;
+			size_t hits = 0;
+			size_t misses = 0;
 		};
 
 		std::pair<std::string, std::string> OpenFiles(std::string htmlPath, std::string CSSPath = "");
 		// Returns the root of the document
 		std::shared_ptr<HTMLElement> Parse(std::string htmlPath, std::string CSSPath = "");
+		// Builds the tree without applying any css
+		std::shared_ptr<HTMLElement> ParseHTML(const std::string& html);
+		// Reports the tags and text in document order without building a tree or copying any text.
+		// Tags are not matched up, closing tags are reported as written
+		void ParseSAX(std::string_view html, const SAXHandler& handler);
 		// Gets the current token and advances the index
 		Token getToken(const std::string& text, unsigned int& index);
 		// Returns true if there are more tags/tokens after the current index
 		bool MoreTokens(const std::string& text, unsigned int index);
 
 		std::vector<CSSRule> parseCSS(const std::string& css);
+		// Parses the "key: value;" pairs of a rule block or style attribute
+		std::map<std::string, std::string> parseDeclarations(const std::string& block);
 		void applyCSSProperties(const std::map<std::string, std::string>& ruleProps, CSSProperties& outProps);
-		void applyCSSRulesToNode(std::shared_ptr<HTMLElement>& node, const std::vector<CSSRule>& cssRules);
+		Atom internAtom(const std::string& text);
+		// Safe to call from any thread, the reference stays valid
+		const std::string& atomName(Atom atom);
+		// Named colors, #rgb, #rgba, #rrggbb, #rrggbbaa, rgb[a]() and hsl[a](). Returns 0xRRGGBBAA, unknown colors are opaque black
+		uint32_t parseColor(std::string_view value);
+		// One to four lengths, as in css
+		CSSEdges parseEdges(const std::string& value);
+		uint16_t parseFontWeight(std::string_view value);
+		void parseBorder(const std::string& value, CSSProperties& outProps);
+		// Compound selectors of tags, "*", #ids and .classes joined by descendant (" ") and child (">") combinators
+		CSSSelector parseSelector(std::string_view selector);
+		// Ids count 10000, classes 100 and tags 1, summed over the compounds. Rules with higher specificity win over earlier ones
+		unsigned int selectorSpecificity(const CSSSelector& selector);
+		unsigned int selectorSpecificity(const std::string& selector);
+		// The filter has to hold the node's ancestors, without one they are walked for every descendant or child selector
+		bool selectorMatches(const CSSSelector& selector, const HTMLElement& node, const AncestorFilter* filter = nullptr);
+		bool selectorMatches(const std::string& selector, const HTMLElement& node);
+		// True if a rule looks at ancestors, then changing an element's tag, id or class can restyle its descendants
+		bool hasCombinators(const std::vector<CSSRule>& cssRules);
+		// Resets everything except the inherited text properties (color and font) to the defaults
+		CSSProperties inheritedProperties(const CSSProperties* parent);
+		// Cascades the rules, in order of specificity, then the inline style over the parent's inherited properties
+		CSSProperties computeStyle(const HTMLElement& node, const std::vector<CSSRule>& cssRules, const AncestorFilter* filter = nullptr);
+		// Recomputes the style of a single node, its parent has to be styled already
+		void restyleNode(HTMLElement& node, const std::vector<CSSRule>& cssRules);
+		void restyleNode(HTMLElement& node, const std::vector<CSSRule>& cssRules, StyleCache& cache, const AncestorFilter* filter = nullptr);
+		// Styles the node and everything inside it
 		void processCSS(std::shared_ptr<HTMLElement>& root, const std::vector<CSSRule>& cssRules);
+		void processCSS(HTMLElement& node, const std::vector<CSSRule>& cssRules, StyleCache& cache);
 
 
 		// Prints all tags from root
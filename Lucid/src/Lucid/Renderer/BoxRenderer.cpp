@@ -0,0 +1,82 @@
+#include "BoxRenderer.hpp"
+#include "GLState.hpp"
+#include "RenderStats.hpp"
+#include "ShaderManager.hpp"
+
+#include <cstddef>
+
+namespace Lucid {
+	namespace BoxRenderer {
+		GLuint VAO, quadVBO, instanceVBO;
+		GLsizeiptr instanceCapacity = 0; // bytes allocated for the instance buffer
+		Shader shader;
+		GLint viewportLocation = -1;
+
+		void Init()
+		{
+			const float corners[] = {
+				0.0f, 0.0f,
+				1.0f, 0.0f,
+				0.0f, 1.0f,
+				1.0f, 1.0f
+			};
+
+			glGenVertexArrays(1, &VAO);
+			glGenBuffers(1, &quadVBO);
+			glGenBuffers(1, &instanceVBO);
+
+			GLState::BindVertexArray(VAO);
+
+			GLState::BindBuffer(GL_ARRAY_BUFFER, quadVBO);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
+
+			// Everything else advances once per box
+			GLState::BindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+			const GLsizei stride = sizeof(Box);
+			const size_t offsets[] = { offsetof(Box, position), offsetof(Box, color), offsetof(Box, borderColor), offsetof(Box, borderWidth) };
+			const GLint sizes[] = { 4, 4, 4, 2 };
+			for (GLuint i = 0; i < 4; ++i) {
+				glEnableVertexAttribArray(i + 1);
+				glVertexAttribPointer(i + 1, sizes[i], GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsets[i]));
+				glVertexAttribDivisor(i + 1, 1);
+			}
+
+			shader = ShaderManager::Get("Lucid/Box");
+			viewportLocation = shader.getUniformLocation("viewport");
+			instanceCapacity = 0;
+		}
+
+		void Draw(const std::vector<Box>& boxes, glm::vec2 windowSize)
+		{
+			if (boxes.empty()) return;
+
+			shader.use();
+			shader.setVec2(viewportLocation, windowSize);
+			RenderStats::CountCalls();
+			GLState::SetBlending(true);
+			GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			GLState::BindVertexArray(VAO);
+			GLState::BindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+
+			// Orphan the old storage so the driver doesn't wait for last frame's draw to finish reading it,
+			// the buffer only grows so steady frames never reallocate
+			GLsizeiptr bytes = static_cast<GLsizeiptr>(boxes.size() * sizeof(Box));
+			if (bytes > instanceCapacity) instanceCapacity = bytes + bytes / 2;
+			glBufferData(GL_ARRAY_BUFFER, instanceCapacity, nullptr, GL_STREAM_DRAW);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, boxes.data());
+			RenderStats::CountCalls(); // the orphaning glBufferData moves no data
+			RenderStats::CountUpload(bytes);
+
+			glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(boxes.size()));
+			RenderStats::CountDraw();
+		}
+
+		void CountMemory(MemoryStats::SharedUsage& usage)
+		{
+			usage.gpuBuffers.count += 2;
+			usage.gpuBuffers.bytes += 8 * sizeof(float) + static_cast<uint64_t>(instanceCapacity);
+		}
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "../Text/Shader/Shader.hpp"
+#include "../Memory/MemoryStats.hpp"
+
+namespace Lucid {
+	// Draws backgrounds and borders as instanced quads, every box of a frame goes out in one draw call
+	namespace BoxRenderer {
+		// One instance, the layout matches the per-instance attributes in Box.vert
+		struct Box {
+			glm::vec2 position{};
+			glm::vec2 size{};
+			glm::vec4 color{};
+			glm::vec4 borderColor{};
+			float borderWidth = 0.0f;
+			float radius = 0.0f;
+		};
+
+		void Init();
+
+		// Streams the boxes into the instance buffer and draws them in order, later boxes on top
+		void Draw(const std::vector<Box>& boxes, glm::vec2 windowSize);
+
+		// Adds the quad and instance buffers to usage
+		void CountMemory(MemoryStats::SharedUsage& usage);
+	}
+}
@@ -0,0 +1,159 @@
+#include "GLState.hpp"
+
+namespace Lucid {
+	namespace GLState {
+		// 0 is a valid binding, so unknown state is kept apart from it
+		constexpr GLuint Unknown = ~0u;
+		constexpr size_t MaxTextureUnits = 16;
+
+		GLuint currentProgram = Unknown;
+		GLuint currentVertexArray = Unknown;
+		GLuint currentArrayBuffer = Unknown;
+		GLenum currentTextureUnit = Unknown;
+		std::array<GLuint, MaxTextureUnits> currentTextures = [] {
+			std::array<GLuint, MaxTextureUnits> textures;
+			textures.fill(Unknown);
+			return textures;
+		}();
+		int blendEnabled = -1;
+		GLenum blendSource = Unknown, blendDestination = Unknown;
+
+		Stats stats;
+
+		uint64_t Stats::issued() const
+		{
+			return program.issued + vertexArray.issued + buffer.issued + texture.issued + blend.issued;
+		}
+
+		uint64_t Stats::elided() const
+		{
+			return program.elided + vertexArray.elided + buffer.elided + texture.elided + blend.elided;
+		}
+
+		// Returns true if the call needs to be issued
+		template<typename T>
+		inline bool Track(T& current, T value, Counter& counter)
+		{
+			if (current == value) {
+				++counter.elided;
+				return false;
+			}
+
+			current = value;
+			++counter.issued;
+			return true;
+		}
+
+		void UseProgram(GLuint program)
+		{
+			if (Track(currentProgram, program, stats.program)) glUseProgram(program);
+		}
+
+		void BindVertexArray(GLuint vertexArray)
+		{
+			if (Track(currentVertexArray, vertexArray, stats.vertexArray)) glBindVertexArray(vertexArray);
+		}
+
+		void BindBuffer(GLenum target, GLuint buffer)
+		{
+			// The element array binding belongs to the bound vertex array, so only the array buffer is shadowed
+			if (target != GL_ARRAY_BUFFER) {
+				++stats.buffer.issued;
+				glBindBuffer(target, buffer);
+				return;
+			}
+
+			if (Track(currentArrayBuffer, buffer, stats.buffer)) glBindBuffer(target, buffer);
+		}
+
+		void ActiveTexture(GLenum unit)
+		{
+			if (Track(currentTextureUnit, unit, stats.texture)) glActiveTexture(unit);
+		}
+
+		void BindTexture(GLenum target, GLuint texture)
+		{
+			size_t unit = (currentTextureUnit == Unknown) ? MaxTextureUnits : currentTextureUnit - GL_TEXTURE0;
+
+			if (target != GL_TEXTURE_2D || unit >= MaxTextureUnits) {
+				++stats.texture.issued;
+				glBindTexture(target, texture);
+				return;
+			}
+
+			if (Track(currentTextures[unit], texture, stats.texture)) glBindTexture(target, texture);
+		}
+
+		void SetBlending(bool enabled)
+		{
+			if (Track(blendEnabled, enabled ? 1 : 0, stats.blend)) {
+				if (enabled) glEnable(GL_BLEND);
+				else glDisable(GL_BLEND);
+			}
+		}
+
+		void BlendFunc(GLenum source, GLenum destination)
+		{
+			if (blendSource == source && blendDestination == destination) {
+				++stats.blend.elided;
+				return;
+			}
+
+			blendSource = source;
+			blendDestination = destination;
+			++stats.blend.issued;
+			glBlendFunc(source, destination);
+		}
+
+		void Invalidate()
+		{
+			currentProgram = Unknown;
+			currentVertexArray = Unknown;
+			currentArrayBuffer = Unknown;
+			currentTextureUnit = Unknown;
+			currentTextures.fill(Unknown);
+			blendEnabled = -1;
+			blendSource = blendDestination = Unknown;
+		}
+
+		void Forget(Object type, GLuint object)
+		{
+			switch (type) {
+			case Object::Program:
+				if (currentProgram == object) currentProgram = Unknown;
+				break;
+			case Object::VertexArray:
+				if (currentVertexArray == object) currentVertexArray = Unknown;
+				break;
+			case Object::Buffer:
+				if (currentArrayBuffer == object) currentArrayBuffer = Unknown;
+				break;
+			case Object::Texture:
+				for (GLuint& texture : currentTextures) {
+					if (texture == object) texture = Unknown;
+				}
+				break;
+			}
+		}
+
+		const Stats& GetStats()
+		{
+			return stats;
+		}
+
+		void ResetStats()
+		{
+			stats = Stats();
+		}
+
+		void PrintStats(std::ostream& out)
+		{
+			out << "GL calls issued: " << stats.issued() << ", elided: " << stats.elided()
+				<< " (program " << stats.program.elided
+				<< ", vertex array " << stats.vertexArray.elided
+				<< ", buffer " << stats.buffer.elided
+				<< ", texture " << stats.texture.elided
+				<< ", blend " << stats.blend.elided << ")" << std::endl;
+		}
+	}
+}
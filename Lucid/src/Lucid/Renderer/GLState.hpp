@@ -0,0 +1,54 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+
+namespace Lucid {
+	// Shadows the GL binding state so redundant binds never reach the driver.
+	// All program, vertex array, array buffer, texture and blend changes have to go through here,
+	// otherwise call Invalidate so the cached state is not trusted anymore
+	namespace GLState {
+		enum class Object {
+			Program,
+			VertexArray,
+			Buffer,
+			Texture
+		};
+
+		struct Counter {
+			uint64_t issued = 0;
+			uint64_t elided = 0;
+		};
+
+		struct Stats {
+			Counter program;
+			Counter vertexArray;
+			Counter buffer;
+			Counter texture;
+			Counter blend;
+
+			uint64_t issued() const;
+			uint64_t elided() const;
+		};
+
+		void UseProgram(GLuint program);
+		void BindVertexArray(GLuint vertexArray);
+		void BindBuffer(GLenum target, GLuint buffer);
+		void ActiveTexture(GLenum unit);
+		void BindTexture(GLenum target, GLuint texture);
+		void SetBlending(bool enabled);
+		void BlendFunc(GLenum source, GLenum destination);
+
+		// Forgets everything cached, the next call of each kind is always issued
+		void Invalidate();
+		// Call when a GL object is deleted so a new object reusing its name is not skipped
+		void Forget(Object type, GLuint object);
+
+		/* ---Getters--- */
+		const Stats& GetStats();
+		void ResetStats();
+		void PrintStats(std::ostream& out = std::cout);
+	}
+}
@@ -0,0 +1,82 @@
+#include "ImageRenderer.hpp"
+#include "GLState.hpp"
+#include "RenderStats.hpp"
+#include "ShaderManager.hpp"
+
+namespace Lucid {
+	namespace ImageRenderer {
+		GLuint VAO, VBO;
+		GLsizeiptr capacity = 0; // bytes allocated for the vertex buffer
+		std::vector<glm::vec4> vertices; // reused between frames
+		Shader shader;
+		GLint viewportLocation = -1;
+
+		void Init()
+		{
+			glGenVertexArrays(1, &VAO);
+			glGenBuffers(1, &VBO);
+
+			GLState::BindVertexArray(VAO);
+			GLState::BindBuffer(GL_ARRAY_BUFFER, VBO);
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), 0);
+
+			shader = ShaderManager::Get("Lucid/Image");
+			viewportLocation = shader.getUniformLocation("viewport");
+			capacity = 0;
+		}
+
+		void Draw(const std::vector<Image>& images, glm::vec2 windowSize)
+		{
+			if (images.empty()) return;
+
+			// Two triangles per image, texture rows start at the top like the pixels
+			vertices.clear();
+			for (const Image& image : images) {
+				glm::vec2 low = image.position;
+				glm::vec2 high = image.position + image.size;
+				vertices.push_back({ low.x, low.y, 0.0f, 0.0f });
+				vertices.push_back({ low.x, high.y, 0.0f, 1.0f });
+				vertices.push_back({ high.x, high.y, 1.0f, 1.0f });
+				vertices.push_back({ low.x, low.y, 0.0f, 0.0f });
+				vertices.push_back({ high.x, high.y, 1.0f, 1.0f });
+				vertices.push_back({ high.x, low.y, 1.0f, 0.0f });
+			}
+
+			shader.use();
+			shader.setVec2(viewportLocation, windowSize);
+			RenderStats::CountCalls();
+			GLState::SetBlending(true);
+			GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			GLState::ActiveTexture(GL_TEXTURE0);
+			GLState::BindVertexArray(VAO);
+			GLState::BindBuffer(GL_ARRAY_BUFFER, VBO);
+
+			// Orphaned like the box instances, so the driver doesn't wait for last frame's draws
+			GLsizeiptr bytes = static_cast<GLsizeiptr>(vertices.size() * sizeof(glm::vec4));
+			if (bytes > capacity) capacity = bytes + bytes / 2;
+			glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, vertices.data());
+			RenderStats::CountCalls();
+			RenderStats::CountUpload(bytes);
+
+			// The same icon repeated in a row is one draw
+			size_t start = 0;
+			while (start < images.size()) {
+				size_t end = start + 1;
+				while (end < images.size() && images[end].texture == images[start].texture) ++end;
+
+				GLState::BindTexture(GL_TEXTURE_2D, images[start].texture);
+				glDrawArrays(GL_TRIANGLES, static_cast<GLint>(start * 6), static_cast<GLsizei>((end - start) * 6));
+				RenderStats::CountDraw();
+				start = end;
+			}
+		}
+
+		void CountMemory(MemoryStats::SharedUsage& usage)
+		{
+			usage.gpuBuffers.count += 1;
+			usage.gpuBuffers.bytes += static_cast<uint64_t>(capacity);
+		}
+	}
+}
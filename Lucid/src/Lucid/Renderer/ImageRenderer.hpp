@@ -0,0 +1,28 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "../Text/Shader/Shader.hpp"
+#include "../Memory/MemoryStats.hpp"
+
+namespace Lucid {
+	// Draws textured quads. All quads of a frame are streamed into one buffer, then drawn with a call per run of
+	// quads sharing a texture
+	namespace ImageRenderer {
+		struct Image {
+			GLuint texture = 0;
+			glm::vec2 position{};
+			glm::vec2 size{};
+		};
+
+		void Init();
+
+		// Draws the images in order, later ones on top
+		void Draw(const std::vector<Image>& images, glm::vec2 windowSize);
+
+		// Adds the vertex buffer to usage
+		void CountMemory(MemoryStats::SharedUsage& usage);
+	}
+}
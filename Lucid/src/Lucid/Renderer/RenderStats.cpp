@@ -0,0 +1,45 @@
+#include "RenderStats.hpp"
+#include "GLState.hpp"
+
+namespace Lucid {
+	namespace RenderStats {
+		Stats stats;
+
+		uint64_t Stats::totalGLCalls() const
+		{
+			return glCalls + GLState::GetStats().issued();
+		}
+
+		void CountCalls(uint64_t calls)
+		{
+			stats.glCalls += calls;
+		}
+
+		void CountDraw()
+		{
+			++stats.drawCalls;
+			++stats.glCalls;
+		}
+
+		void CountUpload(uint64_t bytes)
+		{
+			stats.bytesUploaded += bytes;
+			++stats.glCalls;
+		}
+
+		void CountGlyph()
+		{
+			++stats.glyphRasterizations;
+		}
+
+		const Stats& GetStats()
+		{
+			return stats;
+		}
+
+		void ResetStats()
+		{
+			stats = Stats();
+		}
+	}
+}
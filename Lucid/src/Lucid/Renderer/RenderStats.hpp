@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+
+namespace Lucid {
+	// Counts the work the renderer hands to the driver, for the benchmark and for checking batching.
+	// Binds and blend changes are counted by GLState, everything else is counted where it is issued
+	namespace RenderStats {
+		struct Stats {
+			uint64_t drawCalls = 0;
+			uint64_t glCalls = 0; // draws, uploads, uniforms and texture setup, not what GLState issues
+			uint64_t glyphRasterizations = 0;
+			uint64_t bytesUploaded = 0;
+
+			// With the binds GLState let through
+			uint64_t totalGLCalls() const;
+		};
+
+		void CountCalls(uint64_t calls = 1);
+		void CountDraw();
+		void CountUpload(uint64_t bytes);
+		void CountGlyph();
+
+		/* ---Getters--- */
+		const Stats& GetStats();
+		void ResetStats();
+	}
+}
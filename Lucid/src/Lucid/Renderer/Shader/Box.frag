@@ -0,0 +1,28 @@
+#version 330 core
+in vec2 LocalPos;
+in vec2 HalfSize;
+flat in vec4 Fill;
+flat in vec4 Stroke;
+flat in vec2 BorderRadius;
+out vec4 color;
+
+// Distance to the edge of a rounded rectangle centered on the origin, negative inside
+float roundedBox(vec2 position, vec2 halfSize, float radius)
+{
+    vec2 q = abs(position) - halfSize + radius;
+    return length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - radius;
+}
+
+void main()
+{
+    float radius = min(BorderRadius.y, min(HalfSize.x, HalfSize.y));
+    float outer = roundedBox(LocalPos, HalfSize, radius);
+    float inner = outer + BorderRadius.x;
+
+    // One pixel of antialiasing on each edge
+    float coverage = clamp(0.5 - outer, 0.0, 1.0);
+    float border = BorderRadius.x > 0.0 ? clamp(0.5 + inner, 0.0, 1.0) : 0.0;
+
+    vec4 result = mix(Fill, Stroke, border);
+    color = vec4(result.rgb, result.a * coverage);
+}
@@ -0,0 +1,27 @@
+#version 330 core
+layout (location = 0) in vec2 corner; // unit quad, 0..1
+layout (location = 1) in vec4 rect; // <vec2 position, vec2 size> per box
+layout (location = 2) in vec4 fillColor;
+layout (location = 3) in vec4 strokeColor;
+layout (location = 4) in vec2 strokeRadius; // <border width, corner radius>
+
+out vec2 LocalPos;
+out vec2 HalfSize;
+flat out vec4 Fill;
+flat out vec4 Stroke;
+flat out vec2 BorderRadius;
+
+uniform vec2 viewport;
+
+void main()
+{
+    vec2 pixel = rect.xy + corner * rect.zw;
+    // Pixels count down from the top left, clip space up from the center
+    gl_Position = vec4(pixel.x / viewport.x * 2.0 - 1.0, 1.0 - pixel.y / viewport.y * 2.0, 0.0, 1.0);
+
+    HalfSize = rect.zw * 0.5;
+    LocalPos = (corner - 0.5) * rect.zw;
+    Fill = fillColor;
+    Stroke = strokeColor;
+    BorderRadius = strokeRadius;
+}
@@ -0,0 +1,10 @@
+#version 330 core
+in vec2 TexCoords;
+out vec4 color;
+
+uniform sampler2D image;
+
+void main()
+{
+    color = texture(image, TexCoords);
+}
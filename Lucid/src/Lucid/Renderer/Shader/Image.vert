@@ -0,0 +1,13 @@
+#version 330 core
+layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>, position in pixels
+
+out vec2 TexCoords;
+
+uniform vec2 viewport;
+
+void main()
+{
+    // Pixels count down from the top left, clip space up from the center
+    gl_Position = vec4(vertex.x / viewport.x * 2.0 - 1.0, 1.0 - vertex.y / viewport.y * 2.0, 0.0, 1.0);
+    TexCoords = vertex.zw;
+}
@@ -0,0 +1,303 @@
+#include "ShaderManager.hpp"
+#include "../Resources/Resources.hpp"
+
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <vector>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace Lucid {
+	namespace ShaderManager {
+		// Program binaries are core only from 4.1 and parallel compiles are an extension, so neither is in the
+		// 3.3 loader. Their functions are looked up at runtime and only used when the driver has them
+		constexpr GLenum ProgramBinaryRetrievableHint = 0x8257;
+		constexpr GLenum ProgramBinaryLength = 0x8741;
+		constexpr GLenum NumProgramBinaryFormats = 0x87FE;
+
+		using GetProgramBinaryProc = void (APIENTRY*)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+		using ProgramBinaryProc = void (APIENTRY*)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+		using ProgramParameteriProc = void (APIENTRY*)(GLuint program, GLenum name, GLint value);
+		using MaxShaderCompilerThreadsProc = void (APIENTRY*)(GLuint count);
+
+		struct Driver {
+			bool queried = false;
+			std::string id; // vendor, renderer and version, a driver update invalidates the binaries
+			GetProgramBinaryProc getProgramBinary = nullptr;
+			ProgramBinaryProc programBinary = nullptr;
+			ProgramParameteriProc programParameteri = nullptr;
+
+			bool binaries() const { return getProgramBinary && programBinary && programParameteri; }
+		};
+
+		struct Program {
+			std::string vertexCode, fragmentCode;
+			Shader shader;
+			bool built = false;
+		};
+
+		// Nodes don't move, so the shaders handed out by Get stay put
+		std::unordered_map<std::string, Program> programs;
+		bool builtInsQueued = false;
+		fs::path cacheDirectory;
+		Driver driver;
+		Stats stats;
+
+		static void queueBuiltIns()
+		{
+			if (builtInsQueued) return;
+			builtInsQueued = true;
+
+			programs["Lucid/Text"] = { std::string(Resources::Get("Lucid/Text/Shader/Text.vert")), std::string(Resources::Get("Lucid/Text/Shader/Text.frag")) };
+			programs["Lucid/Box"] = { std::string(Resources::Get("Lucid/Renderer/Shader/Box.vert")), std::string(Resources::Get("Lucid/Renderer/Shader/Box.frag")) };
+			programs["Lucid/Image"] = { std::string(Resources::Get("Lucid/Renderer/Shader/Image.vert")), std::string(Resources::Get("Lucid/Renderer/Shader/Image.frag")) };
+		}
+
+		static std::string glString(GLenum name)
+		{
+			const GLubyte* text = glGetString(name);
+			return text ? reinterpret_cast<const char*>(text) : "";
+		}
+
+		static void queryDriver()
+		{
+			if (driver.queried) return;
+			driver.queried = true;
+			driver.id = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION);
+
+			GLint major = 0, minor = 0, extensionCount = 0;
+			glGetIntegerv(GL_MAJOR_VERSION, &major);
+			glGetIntegerv(GL_MINOR_VERSION, &minor);
+			glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+
+			bool programBinaries = major > 4 || (major == 4 && minor >= 1);
+			bool parallelCompile = false;
+			for (GLint i = 0; i < extensionCount; ++i) {
+				const GLubyte* extension = glGetStringi(GL_EXTENSIONS, i);
+				if (!extension) continue;
+				if (std::strcmp(reinterpret_cast<const char*>(extension), "GL_ARB_get_program_binary") == 0) programBinaries = true;
+				if (std::strcmp(reinterpret_cast<const char*>(extension), "GL_KHR_parallel_shader_compile") == 0) parallelCompile = true;
+			}
+
+			// Some drivers have the functions but no format to save in
+			GLint formats = 0;
+			if (programBinaries) glGetIntegerv(NumProgramBinaryFormats, &formats);
+			if (formats > 0) {
+				driver.getProgramBinary = reinterpret_cast<GetProgramBinaryProc>(glfwGetProcAddress("glGetProgramBinary"));
+				driver.programBinary = reinterpret_cast<ProgramBinaryProc>(glfwGetProcAddress("glProgramBinary"));
+				driver.programParameteri = reinterpret_cast<ProgramParameteriProc>(glfwGetProcAddress("glProgramParameteri"));
+			}
+
+			if (parallelCompile) {
+				auto maxThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(glfwGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+				// As many as the driver wants
+				if (maxThreads) maxThreads(0xFFFFFFFF);
+			}
+		}
+
+		// FNV-1a, the file name only has to change when the sources or the driver do
+		static uint64_t hashProgram(const Program& program)
+		{
+			uint64_t hash = 14695981039346656037ull;
+			auto add = [&hash](std::string_view text) {
+				for (char c : text) hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+				hash = (hash ^ 0xff) * 1099511628211ull; // keeps "ab" + "c" apart from "a" + "bc"
+			};
+			add(program.vertexCode);
+			add(program.fragmentCode);
+			add(driver.id);
+			return hash;
+		}
+
+		static fs::path binaryPath(const std::string& name, const Program& program)
+		{
+			std::string file = name;
+			for (char& c : file) {
+				if (!std::isalnum(static_cast<unsigned char>(c))) c = '_';
+			}
+
+			char hash[17];
+			std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(hashProgram(program)));
+			return cacheDirectory / (file + "-" + hash + ".bin");
+		}
+
+		static bool cacheEnabled()
+		{
+			return !cacheDirectory.empty() && driver.binaries();
+		}
+
+		static bool loadBinary(const std::string& name, Program& program)
+		{
+			if (!cacheEnabled()) return false;
+
+			fs::path path = binaryPath(name, program);
+			std::ifstream file(path, std::ios::binary);
+			if (!file) return false;
+
+			// The format the driver saved it in, then the binary
+			std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+			if (data.size() <= sizeof(GLenum)) return false;
+			GLenum format;
+			std::memcpy(&format, data.data(), sizeof(format));
+
+			GLuint id = glCreateProgram();
+			driver.programBinary(id, format, data.data() + sizeof(format), static_cast<GLsizei>(data.size() - sizeof(format)));
+
+			GLint linked = GL_FALSE;
+			glGetProgramiv(id, GL_LINK_STATUS, &linked);
+			if (!linked) {
+				// Same driver string but a binary it won't take, build it again
+				glDeleteProgram(id);
+				std::error_code error;
+				fs::remove(path, error);
+				return false;
+			}
+
+			program.shader = Shader::FromProgram(id);
+			return true;
+		}
+
+		static void saveBinary(const std::string& name, const Program& program)
+		{
+			if (!cacheEnabled()) return;
+
+			GLint length = 0;
+			glGetProgramiv(program.shader.ID, ProgramBinaryLength, &length);
+			if (length <= 0) return;
+
+			std::vector<char> data(sizeof(GLenum) + length);
+			GLenum format = 0;
+			GLsizei written = 0;
+			driver.getProgramBinary(program.shader.ID, length, &written, &format, data.data() + sizeof(GLenum));
+			if (written <= 0) return;
+			std::memcpy(data.data(), &format, sizeof(format));
+
+			std::error_code error;
+			fs::create_directories(cacheDirectory, error);
+
+			// Written next to it and renamed, so another instance starting up never reads half a file
+			fs::path path = binaryPath(name, program);
+			fs::path temporary = path;
+			temporary += ".tmp";
+			{
+				std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+				if (!file.write(data.data(), sizeof(GLenum) + written)) return;
+			}
+			fs::rename(temporary, path, error);
+			if (error) fs::remove(temporary, error);
+		}
+
+		// Starts every build before checking any, asking for a status waits for that build to finish
+		static void build(const std::vector<std::pair<const std::string*, Program*>>& queue)
+		{
+			struct Build {
+				const std::string* name;
+				Program* program;
+				GLuint vertex, fragment, id;
+			};
+			std::vector<Build> builds;
+
+			for (const auto& [name, program] : queue) {
+				if (loadBinary(*name, *program)) {
+					program->built = true;
+					++stats.loaded;
+					continue;
+				}
+
+				Build started{ name, program };
+				started.vertex = Shader::startCompile(GL_VERTEX_SHADER, program->vertexCode);
+				started.fragment = Shader::startCompile(GL_FRAGMENT_SHADER, program->fragmentCode);
+				started.id = glCreateProgram();
+				glAttachShader(started.id, started.vertex);
+				glAttachShader(started.id, started.fragment);
+				if (cacheEnabled()) driver.programParameteri(started.id, ProgramBinaryRetrievableHint, GL_TRUE);
+				glLinkProgram(started.id);
+				builds.push_back(started);
+			}
+
+			for (Build& started : builds) {
+				bool compiled = Shader::checkCompileErrors(started.vertex, "VERTEX");
+				compiled = Shader::checkCompileErrors(started.fragment, "FRAGMENT") && compiled;
+				bool linked = Shader::checkCompileErrors(started.id, "PROGRAM");
+				if (!compiled || !linked) std::cout << "Failed to build shader program: " << *started.name << std::endl;
+
+				glDeleteShader(started.vertex);
+				glDeleteShader(started.fragment);
+
+				started.program->shader = Shader::FromProgram(started.id);
+				started.program->built = true;
+				if (compiled && linked) {
+					++stats.compiled;
+					saveBinary(*started.name, *started.program);
+				}
+				else ++stats.failed;
+			}
+		}
+
+		void Add(const std::string& name, std::string_view vertexCode, std::string_view fragmentCode)
+		{
+			queueBuiltIns();
+
+			// Renderers keep copies of what Get returned, a program in use can't be swapped underneath them
+			auto it = programs.find(name);
+			if (it != programs.end() && it->second.built) throw std::runtime_error("Shader program already built: " + name);
+			programs[name] = { std::string(vertexCode), std::string(fragmentCode) };
+		}
+
+		void CompileAll()
+		{
+			queueBuiltIns();
+			queryDriver();
+
+			auto start = std::chrono::steady_clock::now();
+
+			std::vector<std::pair<const std::string*, Program*>> queue;
+			for (auto& [name, program] : programs) {
+				if (!program.built) queue.push_back({ &name, &program });
+			}
+			build(queue);
+
+			stats.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		const Shader& Get(const std::string& name)
+		{
+			queueBuiltIns();
+
+			auto it = programs.find(name);
+			if (it == programs.end()) throw std::runtime_error("Unknown shader program: " + name);
+
+			if (!it->second.built) {
+				queryDriver();
+				auto start = std::chrono::steady_clock::now();
+				build({ { &it->first, &it->second } });
+				stats.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			}
+			return it->second.shader;
+		}
+
+		void SetCacheDirectory(const fs::path& directory)
+		{
+			cacheDirectory = directory;
+		}
+
+		const Stats& GetStats()
+		{
+			return stats;
+		}
+
+		void PrintStats(std::ostream& out)
+		{
+			out << "Shader programs loaded: " << stats.loaded << ", compiled: " << stats.compiled
+				<< ", failed: " << stats.failed << " in " << stats.milliseconds << "ms" << std::endl;
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <string>
+#include <cstdint>
+#include <iostream>
+#include <filesystem>
+#include <string_view>
+
+#include "../Text/Shader/Shader.hpp"
+
+namespace Lucid {
+	// Builds all shader programs up front instead of one at a time as the renderers start.
+	// Every shader is handed to the driver before any result is checked, so drivers with
+	// GL_KHR_parallel_shader_compile (or their own threads) compile them at the same time.
+	// Linked programs are saved with glGetProgramBinary, keyed by a hash of the sources and the driver,
+	// and loaded from there on later launches. Binaries the driver rejects are compiled again
+	namespace ShaderManager {
+		struct Stats {
+			int loaded = 0;   // from the binary cache
+			int compiled = 0;
+			int failed = 0;
+			double milliseconds = 0.0; // spent in CompileAll and Get
+		};
+
+		// Queues a program for CompileAll, Lucid's own programs are always queued. A queued name replaces the older one,
+		// throws if that one is already built
+		void Add(const std::string& name, std::string_view vertexCode, std::string_view fragmentCode);
+		// Builds every queued program, needs the GL context
+		void CompileAll();
+		// Builds the program now if CompileAll hasn't. Throws for unknown names
+		const Shader& Get(const std::string& name);
+
+		/* ---Setters--- */
+		// Where program binaries are kept, empty (the default) turns the cache off
+		void SetCacheDirectory(const std::filesystem::path& directory);
+
+		/* ---Getters--- */
+		const Stats& GetStats();
+		void PrintStats(std::ostream& out = std::cout);
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <span>
+#include <cstddef>
+#include <string_view>
+
+namespace Lucid {
+	namespace Resources {
+		struct Entry {
+			std::string_view name; // path under src, with forward slashes
+			const unsigned char* data;
+			size_t size;
+		};
+
+		// Sorted by name. Defined in Embedded.cpp, which tools/embed.py generates before every build
+		extern const std::span<const Entry> entries;
+
+		template<size_t N>
+		constexpr bool IsSorted(const Entry (&table)[N])
+		{
+			for (size_t i = 1; i < N; ++i) {
+				if (!(table[i - 1].name < table[i].name)) return false;
+			}
+			return true;
+		}
+	}
+}
@@ -0,0 +1,86 @@
+#include "Resources.hpp"
+#include "Embedded.hpp"
+
+#include <mutex>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <functional>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace Lucid {
+	namespace Resources {
+		// Pages can be loaded from worker threads
+		std::mutex mutex;
+		fs::path overrideDirectory;
+		std::unordered_map<std::string, std::string> overridden; // owns the data handed out for files read from disk
+
+		const Entry* FindEmbedded(std::string_view name)
+		{
+			auto entry = std::lower_bound(entries.begin(), entries.end(), name, [](const Entry& entry, std::string_view name) {
+				return entry.name < name;
+			});
+			return entry != entries.end() && entry->name == name ? &*entry : nullptr;
+		}
+
+		fs::path OverridePath(const std::string& name)
+		{
+			if (overrideDirectory.empty()) return {};
+
+			fs::path file = overrideDirectory / fs::path(name);
+			return fs::is_regular_file(file) ? file : fs::path();
+		}
+
+		std::string_view Get(const std::string& name)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			auto cached = overridden.find(name);
+			if (cached != overridden.end()) return cached->second;
+
+			fs::path file = OverridePath(name);
+			if (!file.empty()) {
+				std::ifstream stream(file, std::ios::binary);
+				if (!stream) throw std::runtime_error("Failed to open resource file: " + file.string());
+				std::string data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+				return overridden.emplace(name, std::move(data)).first->second;
+			}
+
+			const Entry* entry = FindEmbedded(name);
+			if (!entry) throw std::runtime_error("Unknown resource: " + name);
+			return std::string_view(reinterpret_cast<const char*>(entry->data), entry->size);
+		}
+
+		bool Exists(const std::string& name)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return FindEmbedded(name) || overridden.count(name) || !OverridePath(name).empty();
+		}
+
+		bool IsEmbedded(std::string_view data)
+		{
+			std::less<const char*> before;
+			for (const Entry& entry : entries) {
+				const char* begin = reinterpret_cast<const char*>(entry.data);
+				if (!before(data.data(), begin) && !before(begin + entry.size, data.data() + data.size())) return true;
+			}
+			return false;
+		}
+
+		void SetOverrideDirectory(const fs::path& directory)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			overrideDirectory = directory;
+			overridden.clear();
+		}
+
+		fs::path GetPath(const std::string& name)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return OverridePath(name);
+		}
+	}
+}
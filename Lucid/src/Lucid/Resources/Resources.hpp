@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include <filesystem>
+#include <string_view>
+
+namespace Lucid {
+	// Shaders, fonts and the default pages are compiled into the binary, so starting up reads nothing from disk.
+	// Resources are named by their path under src with forward slashes, e.g. "Lucid/Fonts/arial.ttf"
+	namespace Resources {
+		// Throws if there is no such resource. The data stays valid until the override directory changes
+		std::string_view Get(const std::string& name);
+		bool Exists(const std::string& name);
+		// Whether data lies in the binary's own copy of a resource, which stays valid for the whole run
+		bool IsEmbedded(std::string_view data);
+
+		// Files under the directory are used instead of the embedded ones with the same name, for editing
+		// shaders and pages without rebuilding. Each file is read the first time it is asked for, empty turns it off
+		void SetOverrideDirectory(const std::filesystem::path& directory);
+
+		/* ---Getters--- */
+		// The file on disk a resource comes from, empty if it comes from the binary
+		std::filesystem::path GetPath(const std::string& name);
+	}
+}
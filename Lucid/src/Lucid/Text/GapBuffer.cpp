@@ -0,0 +1,235 @@
+#include "GapBuffer.hpp"
+
+namespace Lucid {
+	namespace Text {
+		constexpr size_t MinimumGap = 64;
+
+		std::string EncodeUTF8(unsigned int codepoint)
+		{
+			std::string out;
+
+			if (codepoint < 0x80) {
+				out += static_cast<char>(codepoint);
+			}
+			else if (codepoint < 0x800) {
+				out += static_cast<char>(0xC0 | (codepoint >> 6));
+				out += static_cast<char>(0x80 | (codepoint & 0x3F));
+			}
+			else if (codepoint < 0x10000) {
+				if (codepoint >= 0xD800 && codepoint <= 0xDFFF) return out; // surrogates aren't valid on their own
+				out += static_cast<char>(0xE0 | (codepoint >> 12));
+				out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+				out += static_cast<char>(0x80 | (codepoint & 0x3F));
+			}
+			else if (codepoint < 0x110000) {
+				out += static_cast<char>(0xF0 | (codepoint >> 18));
+				out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+				out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+				out += static_cast<char>(0x80 | (codepoint & 0x3F));
+			}
+
+			return out;
+		}
+
+		inline bool isContinuation(char c)
+		{
+			return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+		}
+
+		GapBuffer::GapBuffer(std::string_view text)
+		{
+			setText(text);
+		}
+
+		void GapBuffer::setText(std::string_view text)
+		{
+			buffer.assign(text.begin(), text.end());
+			buffer.resize(text.size() + MinimumGap);
+			gapStart = text.size();
+			gapEnd = buffer.size();
+			anchor = caret = text.size();
+
+			dirty = true;
+			dirtyRange = { 0, text.size() };
+		}
+
+		std::string GapBuffer::text() const
+		{
+			return substr(0, size());
+		}
+
+		std::string GapBuffer::substr(size_t begin, size_t end) const
+		{
+			end = std::min(end, size());
+			if (begin >= end) return {};
+
+			std::string out;
+			out.reserve(end - begin);
+
+			if (begin < gapStart) out.append(buffer.data() + begin, std::min(end, gapStart) - begin);
+			if (end > gapStart) {
+				size_t from = std::max(begin, gapStart);
+				out.append(buffer.data() + from + gapSize(), end - from);
+			}
+			return out;
+		}
+
+		void GapBuffer::insert(std::string_view text)
+		{
+			eraseSelection();
+			if (text.empty()) return;
+
+			moveGap(caret);
+			growGap(text.size());
+
+			std::copy(text.begin(), text.end(), buffer.begin() + gapStart);
+			gapStart += text.size();
+
+			markDirty(caret, 0, text.size());
+			caret += text.size();
+			anchor = caret;
+		}
+
+		void GapBuffer::eraseBackward()
+		{
+			if (hasSelection()) eraseSelection();
+			else if (caret > 0) erase(previousCodepoint(caret), caret);
+		}
+
+		void GapBuffer::eraseForward()
+		{
+			if (hasSelection()) eraseSelection();
+			else if (caret < size()) erase(caret, nextCodepoint(caret));
+		}
+
+		void GapBuffer::eraseSelection()
+		{
+			Range range = selection();
+			if (!range.empty()) erase(range.begin, range.end);
+		}
+
+		void GapBuffer::moveTo(size_t offset, bool select)
+		{
+			offset = std::min(offset, size());
+			// Never land inside a codepoint
+			while (offset > 0 && offset < size() && isContinuation(at(offset))) --offset;
+
+			caret = offset;
+			if (!select) anchor = caret;
+		}
+
+		void GapBuffer::moveLeft(bool select)
+		{
+			// Without shift, left collapses the selection to its start
+			if (hasSelection() && !select) moveTo(selection().begin);
+			else moveTo(previousCodepoint(caret), select);
+		}
+
+		void GapBuffer::moveRight(bool select)
+		{
+			if (hasSelection() && !select) moveTo(selection().end);
+			else moveTo(nextCodepoint(caret), select);
+		}
+
+		void GapBuffer::moveHome(bool select)
+		{
+			size_t offset = caret;
+			while (offset > 0 && at(offset - 1) != '\n') --offset;
+			moveTo(offset, select);
+		}
+
+		void GapBuffer::moveEnd(bool select)
+		{
+			size_t offset = caret;
+			while (offset < size() && at(offset) != '\n') ++offset;
+			moveTo(offset, select);
+		}
+
+		void GapBuffer::selectAll()
+		{
+			anchor = 0;
+			caret = size();
+		}
+
+		GapBuffer::Range GapBuffer::takeDirtyRange()
+		{
+			Range range = dirty ? dirtyRange : Range{ caret, caret };
+			dirty = false;
+			return range;
+		}
+
+		size_t GapBuffer::previousCodepoint(size_t offset) const
+		{
+			if (offset == 0) return 0;
+			--offset;
+			while (offset > 0 && isContinuation(at(offset))) --offset;
+			return offset;
+		}
+
+		size_t GapBuffer::nextCodepoint(size_t offset) const
+		{
+			if (offset >= size()) return size();
+			++offset;
+			while (offset < size() && isContinuation(at(offset))) ++offset;
+			return offset;
+		}
+
+		void GapBuffer::moveGap(size_t offset)
+		{
+			if (offset < gapStart) {
+				// Shift the text between offset and the gap to after the gap
+				size_t count = gapStart - offset;
+				std::move_backward(buffer.begin() + offset, buffer.begin() + gapStart, buffer.begin() + gapEnd);
+				gapStart -= count;
+				gapEnd -= count;
+			}
+			else if (offset > gapStart) {
+				size_t count = offset - gapStart;
+				std::move(buffer.begin() + gapEnd, buffer.begin() + gapEnd + count, buffer.begin() + gapStart);
+				gapStart += count;
+				gapEnd += count;
+			}
+		}
+
+		void GapBuffer::growGap(size_t needed)
+		{
+			if (gapSize() >= needed) return;
+
+			// Grow geometrically so a run of inserts stays amortized O(1) per byte
+			size_t extra = std::max({ needed - gapSize(), buffer.size(), MinimumGap });
+			size_t tail = buffer.size() - gapEnd;
+
+			buffer.resize(buffer.size() + extra);
+			std::move_backward(buffer.begin() + gapEnd, buffer.begin() + gapEnd + tail, buffer.end());
+			gapEnd += extra;
+		}
+
+		void GapBuffer::erase(size_t begin, size_t end)
+		{
+			moveGap(begin);
+			gapEnd += end - begin;
+
+			markDirty(begin, end - begin, 0);
+			anchor = caret = begin;
+		}
+
+		void GapBuffer::markDirty(size_t offset, size_t removed, size_t inserted)
+		{
+			if (!dirty) {
+				dirty = true;
+				dirtyRange = { offset, offset + inserted };
+				return;
+			}
+
+			// Move the existing range into post-edit offsets before merging
+			auto shift = [&](size_t position) {
+				if (position <= offset) return position;
+				if (position >= offset + removed) return position - removed + inserted;
+				return offset + inserted;
+			};
+
+			dirtyRange.begin = std::min(shift(dirtyRange.begin), offset);
+			dirtyRange.end = std::max(shift(dirtyRange.end), offset + inserted);
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <string_view>
+
+namespace Lucid {
+	namespace Text {
+		// Encodes a unicode codepoint as utf-8, invalid codepoints give an empty string
+		std::string EncodeUTF8(unsigned int codepoint);
+
+		// Editable utf-8 text with the free space kept at the last edit, so typing,
+		// deleting and moving around near the cursor only costs the size of the edit.
+		// All offsets are in bytes and always sit on codepoint boundaries
+		class GapBuffer {
+		public:
+			struct Range {
+				size_t begin = 0;
+				size_t end = 0;
+
+				bool empty() const { return begin == end; }
+			};
+
+			GapBuffer() = default;
+			explicit GapBuffer(std::string_view text);
+
+			void setText(std::string_view text);
+			std::string text() const;
+			std::string substr(size_t begin, size_t end) const;
+			size_t size() const { return buffer.size() - gapSize(); }
+			bool empty() const { return size() == 0; }
+
+			/* ---Editing--- */
+			// Replaces the selection (if any) with the text and moves the cursor after it
+			void insert(std::string_view text);
+			// Deletes the selection, or the codepoint before / after the cursor
+			void eraseBackward();
+			void eraseForward();
+			void eraseSelection();
+
+			/* ---Cursor--- */
+			size_t cursor() const { return caret; }
+			Range selection() const { return { std::min(anchor, caret), std::max(anchor, caret) }; }
+			bool hasSelection() const { return anchor != caret; }
+
+			// With select the anchor stays put and the selection grows, otherwise it collapses to the cursor
+			void moveTo(size_t offset, bool select = false);
+			void moveLeft(bool select = false);
+			void moveRight(bool select = false);
+			void moveHome(bool select = false);
+			void moveEnd(bool select = false);
+			void selectAll();
+
+			// Byte range touched by edits since the last call (in current offsets), the cursor moving doesn't count
+			Range takeDirtyRange();
+			bool isDirty() const { return dirty; }
+
+		private:
+			size_t gapSize() const { return gapEnd - gapStart; }
+			char at(size_t offset) const { return offset < gapStart ? buffer[offset] : buffer[offset + gapSize()]; }
+			size_t previousCodepoint(size_t offset) const;
+			size_t nextCodepoint(size_t offset) const;
+
+			void moveGap(size_t offset);
+			void growGap(size_t needed);
+			void erase(size_t begin, size_t end);
+			void markDirty(size_t offset, size_t removed, size_t inserted);
+
+			std::vector<char> buffer;
+			size_t gapStart = 0, gapEnd = 0;
+			size_t anchor = 0, caret = 0;
+
+			Range dirtyRange;
+			bool dirty = false;
+		};
+	}
+}
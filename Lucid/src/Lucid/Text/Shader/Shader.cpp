@@ -1,4 +1,36 @@
 #include "Shader.hpp"
+#include "../../Renderer/GLState.hpp"
+
+// Resolves every active uniform of a linked program, array uniforms get an entry per element
+static void readUniformLocations(GLuint program, std::unordered_map<std::string, GLint>& locations)
+{
+    locations.clear();
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::string name(maxLength, '\0');
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, i, maxLength, &length, &size, &type, name.data());
+
+        std::string uniform = name.substr(0, length);
+        locations[uniform] = glGetUniformLocation(program, uniform.c_str());
+
+        size_t bracket = uniform.find('[');
+        if (size > 1 && bracket != std::string::npos) {
+            std::string base = uniform.substr(0, bracket);
+            locations[base] = locations[uniform];
+            for (GLint element = 1; element < size; ++element) {
+                std::string elementName = base + "[" + std::to_string(element) + "]";
+                locations[elementName] = glGetUniformLocation(program, elementName.c_str());
+            }
+        }
+    }
+}
 
 Shader::Shader(std::string vertexSrc, std::string fragmentSrc, std::string geometryPath)
 {
@@ -41,54 +73,77 @@ Shader::Shader(std::string vertexSrc, std::string fragmentSrc, std::string geome
     {
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
     }
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
+    compile(vertexCode, fragmentCode, geometryCode);
+}
+
+Shader Shader::FromProgram(GLuint program)
+{
+    Shader shader;
+    shader.ID = program;
+    readUniformLocations(program, shader.uniformLocations);
+    return shader;
+}
+
+unsigned int Shader::startCompile(GLenum type, std::string_view code)
+{
+    // the source doesn't have to be null terminated, its length is passed along
+    const char* shaderCode = code.data();
+    GLint shaderLength = static_cast<GLint>(code.size());
+
+    unsigned int shader = glCreateShader(type);
+    glShaderSource(shader, 1, &shaderCode, &shaderLength);
+    glCompileShader(shader);
+    return shader;
+}
+
+void Shader::compile(std::string_view vertexCode, std::string_view fragmentCode, std::string_view geometryCode)
+{
     // 2. compile shaders
     unsigned int vertex, fragment;
     // vertex shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
+    vertex = startCompile(GL_VERTEX_SHADER, vertexCode);
     checkCompileErrors(vertex, "VERTEX");
     // fragment Shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
+    fragment = startCompile(GL_FRAGMENT_SHADER, fragmentCode);
     checkCompileErrors(fragment, "FRAGMENT");
     // if geometry shader is given, compile geometry shader
     unsigned int geometry;
-    if (geometryPath != "")
+    if (!geometryCode.empty())
     {
-        const char* gShaderCode = geometryCode.c_str();
-        geometry = glCreateShader(GL_GEOMETRY_SHADER);
-        glShaderSource(geometry, 1, &gShaderCode, NULL);
-        glCompileShader(geometry);
+        geometry = startCompile(GL_GEOMETRY_SHADER, geometryCode);
         checkCompileErrors(geometry, "GEOMETRY");
     }
     // shader Program
     ID = glCreateProgram();
     glAttachShader(ID, vertex);
     glAttachShader(ID, fragment);
-    if (geometryPath != "")
+    if (!geometryCode.empty())
         glAttachShader(ID, geometry);
     glLinkProgram(ID);
     checkCompileErrors(ID, "PROGRAM");
+    readUniformLocations(ID, uniformLocations);
     // delete the shaders as they're linked into our program now and no longer necessary
     glDeleteShader(vertex);
     glDeleteShader(fragment);
-    if (geometryPath != "")
+    if (!geometryCode.empty())
         glDeleteShader(geometry);
 }
 
 void Shader::use()
 {
-	glUseProgram(ID);
+	Lucid::GLState::UseProgram(ID);
 }
 
-void Shader::checkCompileErrors(unsigned int shader, std::string type)
+GLint Shader::getUniformLocation(const std::string& name) const
+{
+    auto it = uniformLocations.find(name);
+    return it == uniformLocations.end() ? -1 : it->second;
+}
+
+bool Shader::checkCompileErrors(unsigned int shader, std::string type)
 {
     int success;
-    char infoLog[1024];
+    char infoLog[1024] = {};
     if (type != "PROGRAM")
     {
         glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
@@ -107,6 +162,7 @@ void Shader::checkCompileErrors(unsigned int shader, std::string type)
             std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
         }
     }
+    return success;
 }
 
 ComputeShader::ComputeShader(std::string src)
@@ -142,11 +198,18 @@ ComputeShader::ComputeShader(std::string src)
     glAttachShader(ID, compute);
     glLinkProgram(ID);
     checkCompileErrors(ID, "PROGRAM");
+    readUniformLocations(ID, uniformLocations);
 }
 
 void ComputeShader::use()
 {
-    glUseProgram(ID);
+    Lucid::GLState::UseProgram(ID);
+}
+
+GLint ComputeShader::getUniformLocation(const std::string& name) const
+{
+    auto it = uniformLocations.find(name);
+    return it == uniformLocations.end() ? -1 : it->second;
 }
 
 void ComputeShader::checkCompileErrors(unsigned int shader, std::string type)
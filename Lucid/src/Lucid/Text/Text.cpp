@@ -1,8 +1,16 @@
 #include "Text.hpp"
+#include "../Renderer/GLState.hpp"
+#include "../Renderer/RenderStats.hpp"
+#include "../Renderer/ShaderManager.hpp"
+#include "../Resources/Resources.hpp"
 
 #define STB_TRUETYPE_IMPLEMENTATION
 #include <stb_truetype.h>
 
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+
 namespace Lucid {
 	namespace Text {
 #ifdef _WIN32
@@ -19,29 +27,44 @@ namespace Lucid {
 		int languageID = 0;
 #endif
 
+		// The glyphs of one font at one size
+		struct GlyphSet {
+			std::unordered_map<char, Glyph> glyphs;
+			uint64_t textureBytes = 0;
+			uint64_t lastUsed = 0; // useClock when it was last drawn or generated
+		};
+
+		// Documents measure text on their loading threads while the GL thread draws, fonts are only written when loaded
+		std::shared_mutex fontsMutex;
 		std::unordered_map<std::string, Font> fonts;
-		std::unordered_map<std::string, std::unordered_map<float, std::unordered_map<char, Glyph>>> glyphs;
+		// Glyphs and their textures are only touched on the GL thread and need no lock
+		std::unordered_map<std::string, std::unordered_map<float, GlyphSet>> glyphs;
+		uint64_t glyphTextureBytes = 0; // of all sets
+		uint64_t useClock = 0;
 
         std::string activeFont;
 
         unsigned int VAO, VBO;
         Shader shader;
+        GLint projectionLocation = -1, textColorLocation = -1;
+        glm::vec2 projectionSize(0.0f); // window size the projection uniform was last set for
 
-        void Init(const std::string& currentPath) {
+        void Init() {
             glGenVertexArrays(1, &VAO);
             glGenBuffers(1, &VBO);
-            glBindVertexArray(VAO);
-            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            GLState::BindVertexArray(VAO);
+            GLState::BindBuffer(GL_ARRAY_BUFFER, VBO);
             glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
             glEnableVertexAttribArray(0);
             glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
-            glBindVertexArray(0);
 
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            GLState::SetBlending(true);
+            GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-            shader = Shader(currentPath + "Text\\Shader\\Text.vert", currentPath + "Text\\Shader\\Text.frag");
+            shader = ShaderManager::Get("Lucid/Text");
+            projectionLocation = shader.getUniformLocation("projection");
+            textColorLocation = shader.getUniformLocation("textColor");
+            projectionSize = glm::vec2(0.0f);
         }
 
         void LoadFont(const std::string& fontName, const std::string& fontPath, bool setActive) {
@@ -61,22 +84,59 @@ namespace Lucid {
                 throw std::runtime_error("Failed to initialize font");
             }
 
-            fonts[fontName] = std::move(font);
+            {
+                std::unique_lock<std::shared_mutex> lock(fontsMutex);
+                fonts[fontName] = std::move(font);
+            }
 
             if (setActive) setActiveFont(fontName);
         }
 
+        void LoadFontFromMemory(const std::string& fontName, std::string_view data, bool setActive) {
+            if (data.empty()) throw std::runtime_error("Failed to read font data");
+
+            Font font;
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data.data());
+            // Files read from the override directory are freed when it changes
+            if (!Resources::IsEmbedded(data)) {
+                font.data.assign(bytes, bytes + data.size());
+                bytes = font.data.data();
+            }
+            if (!stbtt_InitFont(&font.info, bytes, stbtt_GetFontOffsetForIndex(bytes, 0))) {
+                throw std::runtime_error("Failed to initialize font");
+            }
+
+            {
+                std::unique_lock<std::shared_mutex> lock(fontsMutex);
+                fonts[fontName] = std::move(font);
+            }
+
+            if (setActive) setActiveFont(fontName);
+        }
+
+        // The same scale GenerateGlyphs made the glyphs at
+        static float fontScale(const std::string& fontName, float fontSize) {
+            std::shared_lock<std::shared_mutex> lock(fontsMutex);
+            auto font = fonts.find(fontName);
+            if (font == fonts.end()) throw std::runtime_error("Font not loaded");
+            return stbtt_ScaleForPixelHeight(&font->second.info, fontSize);
+        }
+
         void GenerateGlyphs(const std::string& fontName, float fontSize) {
-            if (glyphs.count(fontName)) {
-                if (glyphs[fontName].count(fontSize)) return; // Avoid regenerating
-            } else throw std::runtime_error("Font not loaded");
+            auto sizes = glyphs.find(fontName);
+            if (sizes != glyphs.end() && sizes->second.count(fontSize)) return; // Avoid regenerating
 
-            Font& font = fonts[fontName];
+            // The lock only covers reading the font, the glyphs are the GL thread's own
+            std::shared_lock<std::shared_mutex> lock(fontsMutex);
+            auto found = fonts.find(fontName);
+            if (found == fonts.end()) throw std::runtime_error("Font not loaded");
+            const Font& font = found->second;
 
             float scale = stbtt_ScaleForPixelHeight(&font.info, fontSize);
-            std::unordered_map<char, Glyph> sizeGlyphs;
+            GlyphSet set;
 
             glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            RenderStats::CountCalls();
 
             for (char c = 32; c < 127; ++c) {
                 int width, height, xoff, yoff;
@@ -84,12 +144,15 @@ namespace Lucid {
 
                 GLuint texID;
                 glGenTextures(1, &texID);
-                glBindTexture(GL_TEXTURE_2D, texID);
+                GLState::BindTexture(GL_TEXTURE_2D, texID);
                 glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, bitmap);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                RenderStats::CountGlyph();
+                RenderStats::CountUpload(static_cast<uint64_t>(width) * height);
+                RenderStats::CountCalls(5); // gen and parameters
 
                 int advance;
                 stbtt_GetCodepointHMetrics(&font.info, c, &advance, nullptr);
@@ -97,7 +160,8 @@ namespace Lucid {
                 int x0, y0, x1, y1;
                 stbtt_GetCodepointBitmapBox(&font.info, c, scale, scale, &x0, &y0, &x1, &y1);
 
-                sizeGlyphs[c] = {
+                set.textureBytes += static_cast<uint64_t>(width) * height;
+                set.glyphs[c] = {
                     texID,
                     width,
                     height,
@@ -108,29 +172,41 @@ namespace Lucid {
 
                 stbtt_FreeBitmap(bitmap, nullptr);
             }
+            lock.unlock();
+
+            set.lastUsed = ++useClock;
+            glyphTextureBytes += set.textureBytes;
+            glyphs[fontName][fontSize] = std::move(set);
 
-            glyphs[fontName][fontSize] = std::move(sizeGlyphs);
+            uint64_t limit = MemoryStats::GetLimits().glyphTextureBytes;
+            if (limit > 0 && glyphTextureBytes > limit) TrimGlyphs(limit);
         }
 
         void setActiveFont(const std::string& fontName)
         {
-            if (fonts.count(fontName) > 0) {
-                activeFont = fontName;
-            }
-            else throw std::runtime_error("Font not loaded");
+            if (!HasFont(fontName)) throw std::runtime_error("Font not loaded");
+            activeFont = fontName;
         }
 
         void RenderText(const std::string& text, glm::vec2 windowSize, glm::vec2 position, float fontSize, glm::vec4 color) {
             shader.use();
-            shader.setMat4("projection", glm::ortho(0.0f, windowSize.x, 0.0f, windowSize.y));
-            shader.setVec3("textColor", color);
-            glActiveTexture(GL_TEXTURE0);
-            glBindVertexArray(VAO);
+            // The program keeps its uniforms, so the projection only changes with the window
+            if (windowSize != projectionSize) {
+                shader.setMat4(projectionLocation, glm::ortho(0.0f, windowSize.x, 0.0f, windowSize.y));
+                projectionSize = windowSize;
+                RenderStats::CountCalls();
+            }
+            shader.setVec3(textColorLocation, color);
+            RenderStats::CountCalls();
+            GLState::ActiveTexture(GL_TEXTURE0);
+            GLState::BindVertexArray(VAO);
 
             if (glyphs[activeFont].count(fontSize) == 0) GenerateGlyphs(activeFont, fontSize);
-            auto& glyphMap = glyphs[activeFont][fontSize];
+            GlyphSet& set = glyphs[activeFont][fontSize];
+            set.lastUsed = ++useClock;
+            auto& glyphMap = set.glyphs;
 
-            float scale = stbtt_ScaleForPixelHeight(&fonts[activeFont].info, fontSize);
+            float scale = fontScale(activeFont, fontSize);
 
             // iterate through all characters
             std::string::const_iterator c;
@@ -154,32 +230,112 @@ namespace Lucid {
                     { xpos + w, ypos + h,   1.0f, 0.0f }
                 };
                 // render glyph texture over quad
-                glBindTexture(GL_TEXTURE_2D, ch.textureID);
+                GLState::BindTexture(GL_TEXTURE_2D, ch.textureID);
                 // update content of VBO memory
-                glBindBuffer(GL_ARRAY_BUFFER, VBO);
+                GLState::BindBuffer(GL_ARRAY_BUFFER, VBO);
                 glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
+                RenderStats::CountUpload(sizeof(vertices));
 
-                glBindBuffer(GL_ARRAY_BUFFER, 0);
                 // render quad
                 glDrawArrays(GL_TRIANGLES, 0, 6);
+                RenderStats::CountDraw();
                 // now advance cursors for next glyph
                 position.x += ch.advance * scale;
             }
-            glBindVertexArray(0);
-            glBindTexture(GL_TEXTURE_2D, 0);
         }
 
         float MeasureTextWidth(const std::string& text, const std::string& fontName, float fontSize) {
-            float scale = stbtt_ScaleForPixelHeight(&fonts[fontName].info, fontSize);
-
-            if (glyphs[fontName].count(fontSize) == 0)
-                GenerateGlyphs(fontName, fontSize);
+            std::shared_lock<std::shared_mutex> lock(fontsMutex);
+            auto font = fonts.find(fontName);
+            if (font == fonts.end()) throw std::runtime_error("Font not loaded");
 
+            // Same advance RenderText moves the pen by, read from the font so no glyph textures are needed
+            float scale = stbtt_ScaleForPixelHeight(&font->second.info, fontSize);
             float width = 0.0f;
             for (char c : text) {
-                width += (glyphs[fontName][fontSize][c].advance >> 6) * scale;
+                // RenderText only has glyphs for printable ascii, anything else doesn't move the pen
+                if (c < 32 || c >= 127) continue;
+
+                int advance;
+                stbtt_GetCodepointHMetrics(&font->second.info, static_cast<unsigned char>(c), &advance, nullptr);
+                width += advance * scale;
             }
             return width;
         }
+
+        void MeasureAdvances(std::string_view text, const std::string& fontName, float fontSize, std::vector<float>& advances) {
+            std::shared_lock<std::shared_mutex> lock(fontsMutex);
+            auto font = fonts.find(fontName);
+            if (font == fonts.end()) throw std::runtime_error("Font not loaded");
+
+            float scale = stbtt_ScaleForPixelHeight(&font->second.info, fontSize);
+            advances.reserve(advances.size() + text.size());
+            for (char c : text) {
+                int advance = 0;
+                if (c >= 32 && c < 127) stbtt_GetCodepointHMetrics(&font->second.info, static_cast<unsigned char>(c), &advance, nullptr);
+                advances.push_back(advance * scale);
+            }
+        }
+
+        bool HasFont(const std::string& fontName) {
+            std::shared_lock<std::shared_mutex> lock(fontsMutex);
+            return fonts.count(fontName) > 0;
+        }
+
+        void CountMemory(MemoryStats::SharedUsage& usage) {
+            {
+                std::shared_lock<std::shared_mutex> lock(fontsMutex);
+                for (const auto& [name, font] : fonts) {
+                    ++usage.fonts.count;
+                    usage.fonts.bytes += sizeof(Font) + MemoryStats::StringBytes(name) + MemoryStats::VectorBytes(font.data);
+                }
+            }
+
+            for (const auto& [name, sizes] : glyphs) {
+                usage.glyphs.bytes += MemoryStats::HashMapBytes(sizes);
+                for (const auto& [size, set] : sizes) {
+                    usage.glyphs.count += set.glyphs.size();
+                    usage.glyphs.bytes += MemoryStats::HashMapBytes(set.glyphs);
+                    usage.glyphTextures.count += set.glyphs.size();
+                    usage.glyphTextures.bytes += set.textureBytes;
+                }
+            }
+
+            // The one quad RenderText streams every glyph through
+            usage.gpuBuffers.count += 1;
+            usage.gpuBuffers.bytes += sizeof(float) * 6 * 4;
+        }
+
+        void TrimGlyphs(uint64_t maxTextureBytes) {
+            if (glyphTextureBytes <= maxTextureBytes) return;
+
+            struct Candidate {
+                uint64_t lastUsed;
+                std::string font;
+                float size;
+            };
+            std::vector<Candidate> candidates;
+            for (const auto& [name, sizes] : glyphs) {
+                for (const auto& [size, set] : sizes) {
+                    // RenderText may still be holding the set it drew last
+                    if (set.lastUsed != useClock) candidates.push_back({ set.lastUsed, name, size });
+                }
+            }
+            std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.lastUsed < b.lastUsed; });
+
+            for (const Candidate& candidate : candidates) {
+                if (glyphTextureBytes <= maxTextureBytes) break;
+
+                auto& sizes = glyphs[candidate.font];
+                GlyphSet& set = sizes[candidate.size];
+                for (const auto& [c, glyph] : set.glyphs) {
+                    glDeleteTextures(1, &glyph.textureID);
+                    GLState::Forget(GLState::Object::Texture, glyph.textureID);
+                }
+                RenderStats::CountCalls(set.glyphs.size());
+                glyphTextureBytes -= set.textureBytes;
+                sizes.erase(candidate.size);
+            }
+        }
 	}
 }
\ No newline at end of file
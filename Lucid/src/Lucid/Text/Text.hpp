@@ -8,17 +8,20 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <iostream>
 #include <unordered_map>
 
 #include "Shader/Shader.hpp"
+#include "../Memory/MemoryStats.hpp"
 
 namespace Lucid {
+	// Fonts can be loaded, looked up and measured from any thread. Glyphs and drawing belong to the thread owning the GL context
 	namespace Text {
 		struct Font {
 			std::string name;
-			std::vector<unsigned char> data;
+			std::vector<unsigned char> data; // a copy unless the font is embedded, those are used in place
 			stbtt_fontinfo info;
 		};
 
@@ -29,12 +32,26 @@ namespace Lucid {
 			int advance;
 		};
 
-		void Init(const std::string& currentPath);
+		// Compiles the embedded text shader
+		void Init();
 
 		void LoadFont(const std::string& fontName, const std::string& fontPath, bool setActive = true);
+		// Embedded resources are used in place, anything else (e.g. an overridden file) is copied
+		void LoadFontFromMemory(const std::string& fontName, std::string_view data, bool setActive = true);
 		void setActiveFont(const std::string& fontName);
 		void GenerateGlyphs(const std::string& fontName, float fontSize = 32.0f);
 		void RenderText(const std::string& text, glm::vec2 windowSize, glm::vec2 position, float fontSize, glm::vec4 color);
+		// Doesn't need a GL context
 		float MeasureTextWidth(const std::string& text, const std::string& fontName, float fontSize);
+		// Appends what each byte of text moves the pen by, summing them gives MeasureTextWidth
+		void MeasureAdvances(std::string_view text, const std::string& fontName, float fontSize, std::vector<float>& advances);
+		bool HasFont(const std::string& fontName);
+
+		/* ---Memory--- */
+		// Adds the fonts, glyphs and glyph textures to usage
+		void CountMemory(MemoryStats::SharedUsage& usage);
+		// Drops the glyphs of the font sizes drawn least recently until their textures fit in maxTextureBytes.
+		// The size drawn last is always kept, dropped sizes are generated again when they are drawn
+		void TrimGlyphs(uint64_t maxTextureBytes);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "Watcher.hpp"
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace Lucid {
+	namespace {
+		// Editors usually write a file in several steps (truncate, write, rename),
+		// so changes are only reported once the files have been quiet for this long
+		constexpr std::chrono::milliseconds settleTime(30);
+	}
+
+#ifdef __linux__
+	void FileWatcher::WatchLoop(std::vector<fs::path> files, std::function<void()> onChange)
+	{
+		int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd < 0) {
+			std::cerr << "Failed to init inotify" << std::endl;
+			return;
+		}
+
+		// Watch the parent directories rather than the files themselves, since
+		// most editors save by replacing the file which drops a file watch
+		std::unordered_map<int, fs::path> directories;
+		for (const fs::path& file : files) {
+			fs::path directory = file.parent_path();
+			int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+			if (wd < 0) std::cerr << "Failed to watch " << directory << std::endl;
+			else directories[wd] = directory;
+		}
+
+		alignas(inotify_event) char buffer[4096];
+		pollfd pfd{ fd, POLLIN, 0 };
+		bool changed = false;
+
+		while (running) {
+			int ready = poll(&pfd, 1, changed ? static_cast<int>(settleTime.count()) : 100);
+
+			if (ready <= 0) {
+				// Timed out with nothing new, report the batch we collected
+				if (changed) {
+					changed = false;
+					onChange();
+				}
+				continue;
+			}
+
+			ssize_t length;
+			while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+				for (char* ptr = buffer; ptr < buffer + length; ) {
+					const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+					ptr += sizeof(inotify_event) + event->len;
+
+					if (event->len == 0 || directories.count(event->wd) == 0) continue;
+
+					fs::path modified = directories[event->wd] / event->name;
+					for (const fs::path& file : files) {
+						if (file == modified) changed = true;
+					}
+				}
+			}
+		}
+
+		close(fd);
+	}
+#else
+	// Fallback for platforms without inotify: poll the modification times
+	void FileWatcher::WatchLoop(std::vector<fs::path> files, std::function<void()> onChange)
+	{
+		std::vector<fs::file_time_type> lastWrite(files.size());
+		std::error_code error;
+
+		for (size_t i = 0; i < files.size(); ++i) {
+			lastWrite[i] = fs::last_write_time(files[i], error);
+		}
+
+		while (running) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+			bool changed = false;
+			for (size_t i = 0; i < files.size(); ++i) {
+				fs::file_time_type time = fs::last_write_time(files[i], error);
+				if (!error && time != lastWrite[i]) {
+					lastWrite[i] = time;
+					changed = true;
+				}
+			}
+
+			if (changed) {
+				std::this_thread::sleep_for(settleTime);
+				onChange();
+			}
+		}
+	}
+#endif
+
+	FileWatcher::~FileWatcher()
+	{
+		Stop();
+	}
+
+	void FileWatcher::Watch(const std::vector<std::string>& paths, std::function<void()> onChange)
+	{
+		Stop();
+
+		std::vector<fs::path> files;
+		for (const std::string& path : paths) {
+			if (!path.empty()) files.push_back(fs::absolute(path));
+		}
+		if (files.empty()) return;
+
+		running = true;
+		watchThread = std::thread(&FileWatcher::WatchLoop, this, std::move(files), std::move(onChange));
+	}
+
+	void FileWatcher::Stop()
+	{
+		running = false;
+		if (watchThread.joinable()) watchThread.join();
+	}
+
+	bool FileWatcher::IsWatching() const
+	{
+		return running;
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <filesystem>
+#include <functional>
+#include <unordered_map>
+
+namespace Lucid {
+	// Watches a set of files on its own background thread
+	class FileWatcher {
+	public:
+		FileWatcher() = default;
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+		~FileWatcher();
+
+		// onChange is called from the watcher thread once per batch of modifications.
+		// Watching again replaces the previous files
+		void Watch(const std::vector<std::string>& paths, std::function<void()> onChange);
+		void Stop();
+
+		/* ---Getters--- */
+		bool IsWatching() const;
+
+	private:
+		void WatchLoop(std::vector<std::filesystem::path> files, std::function<void()> onChange);
+
+		std::thread watchThread;
+		std::atomic<bool> running = false;
+	};
+}
@@ -4,16 +4,16 @@ namespace fs = std::filesystem;
 
 namespace Lucid {
 	GLFWwindow* window;
-	std::string currentPath;
 
 	bool ShouldRedraw;
 	unsigned int SCR_WIDTH = 1000;
 	unsigned int SCR_HEIGHT = 600;
 
-	std::string currentFocusInputID;
-	std::unordered_map<std::string, std::string*> boundTextInputs;
-	std::stack<Div> displayStack;
-	std::vector<TextElement> textElements;
+	Document defaultDocument;
+	Document* activeDocument = &defaultDocument;
+
+	// Last position from cursor_position_callback, so replayed input doesn't need a window to ask
+	glm::vec2 cursor(0.0f);
 
 	void Init(const std::string title) {
 		glfwInit();
@@ -31,6 +31,9 @@ namespace Lucid {
 		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 		glfwSetCharCallback(window, char_callback);
 		glfwSetKeyCallback(window, key_callback);
+		glfwSetScrollCallback(window, scroll_callback);
+		glfwSetCursorPosCallback(window, cursor_position_callback);
+		glfwSetMouseButtonCallback(window, mouse_button_callback);
 
 		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
 		{
@@ -39,12 +42,18 @@ namespace Lucid {
 			return;
 		}
 
-		currentPath = fs::current_path().string() + "\\src\\Lucid\\";
-
 		try {
-			Text::Init(currentPath);
-			Text::LoadFont("Arial", currentPath + "Fonts\\arial.ttf");
-			Text::LoadFont("BRADHITC", currentPath + "Fonts\\BRADHITC.ttf", false);
+			// Built once per driver and source, later launches load the binaries
+			std::error_code error;
+			fs::path temporary = fs::temp_directory_path(error);
+			if (!error) ShaderManager::SetCacheDirectory(temporary / "Lucid" / "ShaderCache");
+			ShaderManager::CompileAll();
+
+			Text::Init();
+			BoxRenderer::Init();
+			ImageRenderer::Init();
+			Text::LoadFontFromMemory("Arial", Resources::Get("Lucid/Fonts/arial.ttf"));
+			Text::LoadFontFromMemory("BRADHITC", Resources::Get("Lucid/Fonts/BRADHITC.TTF"), false);
 		}
 		catch (const std::exception& ex) {
 			std::cout << "\nFailed to init text: " << ex.what() << std::endl;
@@ -54,62 +63,59 @@ namespace Lucid {
 
 		RequestReDraw();
 
-		LoadPage(fs::current_path().string() + "\\src\\demo.html", fs::current_path().string() + "\\src\\demo.css");
+		activeDocument->SetWakeCallback(glfwPostEmptyEvent);
+		ImageCache::SetWakeCallback(glfwPostEmptyEvent);
+
+		// From the files when they are overridden, so hot reload has something to watch
+		fs::path html = Resources::GetPath("demo.html");
+		if (!html.empty()) LoadPageAsync(html.string(), Resources::GetPath("demo.css").string());
+		else activeDocument->LoadPageSource(std::string(Resources::Get("demo.html")), std::string(Resources::Get("demo.css")));
 	}
 
 	void Update()
 	{
-		glfwPollEvents();
+		// Returns early on input or when another thread posts to the document
+		glfwWaitEventsTimeout(0.01);
 
-		currentFocusInputID = "test";
+		activeDocument->Update();
 
-		if (ShouldRedraw) {
+		if (ShouldRedraw || activeDocument->NeedsReDraw()) {
 			Draw();
 			ShouldRedraw = false;
 		}
+		else Latency::DiscardPending();
 
-		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		InputScript::RecordFrame();
 	}
 
 	void LoadPage(const std::string& htmlPath, std::string CSSPath)
 	{
-		LoadPage(Parse(htmlPath, CSSPath));
+		activeDocument->LoadPage(htmlPath, CSSPath);
 	}
 
 	void LoadPage(const std::shared_ptr<HTMLElement>& node)
 	{
-		if (!node) return;
-
-		std::cout << "<" << node->tagName << ", Id: '" << node->attributes.Id << "', Class: '" << node->attributes.Class << "'>";
-		if (!node->content.empty())
-			std::cout << " " << node->content;
-		std::cout << std::endl;
+		activeDocument->LoadPage(node);
+	}
 
-		if (node->tagName == "div") {
-			Div div;
-			div.position = node->properties.position;
-			div.size = {};
-			displayStack.push(div);
-		}
-		else if (node->tagName == "p") {
-			TextElement& text = textElements.emplace_back();
-			text.position = node->properties.position + glm::vec2(0.0f, node->properties.fontSize) + (displayStack.empty() ? glm::vec2(0.0f) : displayStack.top().position);
-			text.text = node->content;
-			text.color = node->properties.color;
-			text.fontSize = node->properties.fontSize;
-			text.font = node->properties.fontfamily;
-		}
+	std::future<bool> LoadPageAsync(const std::string& htmlPath, std::string CSSPath, std::function<void(bool)> onLoaded)
+	{
+		return activeDocument->LoadPageAsync(htmlPath, CSSPath, std::move(onLoaded));
+	}
 
-		// Recursively print children
-		for (const auto& child : node->children) {
-			LoadPage(child);
-		}
+	void PatchPage(const std::shared_ptr<HTMLElement>& reloaded, const std::vector<CSSRule>& reloadedStyleSheet)
+	{
+		activeDocument->PatchPage(reloaded, reloadedStyleSheet);
+	}
 
-		if (node->tagName == "div") {
-			if (!displayStack.empty()) displayStack.pop();
-		}
+	void RebuildElements()
+	{
+		activeDocument->RebuildElements();
+	}
 
-		RequestReDraw();
+	void EnableHotReload(bool enable)
+	{
+		activeDocument->EnableHotReload(enable);
 	}
 
 	void Draw()
@@ -117,15 +123,10 @@ namespace Lucid {
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
-		for (const TextElement text : textElements) {
-			Text::setActiveFont(text.font);
-			Text::RenderText(text.text, { SCR_WIDTH, SCR_HEIGHT }, text.position, text.fontSize, text.color);
-		}
-
-		Text::setActiveFont("BRADHITC");
-		Text::RenderText(*boundTextInputs["test"], { SCR_WIDTH, SCR_HEIGHT }, { 50.0f, 500.0f }, boundTextInputs["test"]->length(), {1.0f, 1.0f, 1.0f, 1.0f});
+		activeDocument->Draw();
 
 		glfwSwapBuffers(window);
+		Latency::MarkPresented();
 	}
 
 	void RequestReDraw()
@@ -135,6 +136,9 @@ namespace Lucid {
 
 	void Terminate()
 	{
+		defaultDocument.EnableHotReload(false);
+		activeDocument->EnableHotReload(false);
+
 		glfwDestroyWindow(window);
 		glfwTerminate();
 	}
@@ -144,6 +148,89 @@ namespace Lucid {
 		return glfwWindowShouldClose(window);
 	}
 
+	Document& GetDocument()
+	{
+		return *activeDocument;
+	}
+
+	void PrintMemoryStats(std::ostream& out)
+	{
+		activeDocument->PrintMemoryStats(out);
+	}
+
+	void SetDocument(Document* document)
+	{
+		activeDocument = document ? document : &defaultDocument;
+		activeDocument->SetWakeCallback(glfwPostEmptyEvent);
+		activeDocument->SetViewportSize({ SCR_WIDTH, SCR_HEIGHT });
+		activeDocument->RequestReDraw();
+	}
+
+	HTMLElement* GetElementById(const std::string& id)
+	{
+		return activeDocument->GetElementById(id);
+	}
+
+	std::vector<HTMLElement*> GetElementsByClassName(const std::string& className)
+	{
+		return activeDocument->GetElementsByClassName(className);
+	}
+
+	void SetText(HTMLElement* element, const std::string& text)
+	{
+		activeDocument->SetText(element, text);
+	}
+
+	void SetAttribute(HTMLElement* element, const std::string& name, const std::string& value)
+	{
+		activeDocument->SetAttribute(element, name, value);
+	}
+
+	void AddClass(HTMLElement* element, const std::string& className)
+	{
+		activeDocument->AddClass(element, className);
+	}
+
+	void RemoveClass(HTMLElement* element, const std::string& className)
+	{
+		activeDocument->RemoveClass(element, className);
+	}
+
+	void SetStyle(HTMLElement* element, const std::string& property, const std::string& value)
+	{
+		activeDocument->SetStyle(element, property, value);
+	}
+
+	void BeginUpdate()
+	{
+		activeDocument->BeginUpdate();
+	}
+
+	void EndUpdate()
+	{
+		activeDocument->EndUpdate();
+	}
+
+	void FlushUpdates()
+	{
+		activeDocument->FlushUpdates();
+	}
+
+	void Bind(const std::string& id, Binding::Observable& value)
+	{
+		activeDocument->Bind(id, value);
+	}
+
+	void BindInput(const std::string& id, Bindable<std::string>& value)
+	{
+		activeDocument->BindInput(id, value);
+	}
+
+	void Unbind(const std::string& id)
+	{
+		activeDocument->Unbind(id);
+	}
+
 	void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 	{
 		SCR_WIDTH = width;
@@ -151,36 +238,51 @@ namespace Lucid {
 
 		glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
 
+		activeDocument->SetViewportSize({ SCR_WIDTH, SCR_HEIGHT });
 		RequestReDraw();
 	}
 
 	void char_callback(GLFWwindow* window, unsigned int codepoint) {
-		char enteredChar = static_cast<char>(codepoint);
+		Latency::MarkInput(Latency::Event::Char);
+		InputScript::Record({ InputScript::Event::Char, static_cast<int>(codepoint) });
 
-		if (!currentFocusInputID.empty()) {
-			if (enteredChar != 0) {
-				*boundTextInputs[currentFocusInputID] += enteredChar;
-			}
-		}
+		activeDocument->OnChar(codepoint);
 	}
 
 	void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 	{
-		RequestReDraw();
+		Latency::MarkInput(Latency::Event::Key);
+		InputScript::Record({ InputScript::Event::Key, key, action, mods });
 
-		if (currentFocusInputID.empty()) return;
+		activeDocument->OnKey(key, action, mods);
 
-		if (key == GLFW_KEY_BACKSPACE && (action == GLFW_PRESS || action == GLFW_REPEAT)) {
-			std::string* str = boundTextInputs[currentFocusInputID];
-			if (!str->empty()) {
-				str->pop_back();
-			}
-		}
-		if (key == GLFW_KEY_TAB && (action == GLFW_PRESS || action == GLFW_REPEAT)) {
-			*boundTextInputs[currentFocusInputID] += "    ";
-		}
 		if (key == GLFW_KEY_LEFT_SHIFT && (action == GLFW_PRESS || action == GLFW_REPEAT)) {
 			Text::setActiveFont("Arial");
 		}
 	}
+
+	void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+	{
+		Latency::MarkInput(Latency::Event::Scroll);
+		InputScript::Record({ InputScript::Event::Scroll, 0, 0, 0, xoffset, yoffset });
+
+		activeDocument->OnScroll(cursor, static_cast<float>(yoffset));
+	}
+
+	void cursor_position_callback(GLFWwindow* window, double x, double y)
+	{
+		Latency::MarkInput(Latency::Event::MouseMove);
+		InputScript::Record({ InputScript::Event::Move, 0, 0, 0, x, y });
+
+		cursor = glm::vec2(x, y);
+		activeDocument->OnMouseMove(cursor);
+	}
+
+	void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
+	{
+		Latency::MarkInput(Latency::Event::MouseButton);
+		InputScript::Record({ InputScript::Event::Button, button, action, mods });
+
+		activeDocument->OnMouseButton(cursor, button, action);
+	}
 }
\ No newline at end of file
@@ -12,37 +12,74 @@
 #include "Elements.hpp"
 #include "Text/Text.hpp"
 #include "Parser/Parser.hpp"
+#include "Resources/Resources.hpp"
+#include "Renderer/ShaderManager.hpp"
+#include "Input/Latency.hpp"
+#include "Input/InputScript.hpp"
+#include "Document/Document.hpp"
 
 namespace Lucid {
-	extern std::unordered_map<std::string, std::string*> boundTextInputs;
-
 	using namespace Parser;
 
+	// The functions below work on the window's document, see Document for the details
 	void Init(const std::string title);
 	void Update();
 	void LoadPage(const std::string& htmlPath, std::string CSSPath = "");
 	void LoadPage(const std::shared_ptr<HTMLElement>& node);
+	// Loads on a worker thread and swaps the page in when it is ready, the current page keeps running meanwhile
+	std::future<bool> LoadPageAsync(const std::string& htmlPath, std::string CSSPath = "", std::function<void(bool)> onLoaded = {});
+	// Applies only the differences between the loaded page and the given tree
+	void PatchPage(const std::shared_ptr<HTMLElement>& reloaded, const std::vector<CSSRule>& reloadedStyleSheet);
+	// Recreates every element from the loaded page
+	void RebuildElements();
+	// Re-parses the current page whenever its html or css file changes on disk and patches the changes in
+	void EnableHotReload(bool enable = true);
 	void Draw();
 	void RequestReDraw();
 	void Terminate();
 
 	/* ---Getters--- */
 	bool WindowShouldClose();
+	// The document shown in the window, which also receives its input
+	Document& GetDocument();
+	// Memory of the window's document and of the shared fonts and glyphs, for the profiler overlay
+	void PrintMemoryStats(std::ostream& out = std::cout);
 
 	/* ---Setters--- */
-	template<typename T>
-	inline void BindInput(const std::string& id, T* valPointer)
-	{
-		if constexpr (std::is_same<T, std::string>::value) {
-			boundTextInputs[id] = valPointer;
-		}
-		else {
-			static_assert(std::is_same<T, std::string>::value, "Unsupported BindInput type");
-		}
-	}
+	// Shows another document in the window, nullptr goes back to the built-in one
+	void SetDocument(Document* document);
+
+	/* ---DOM--- */
+	// Returned elements stay valid until the page is loaded again or its structure is hot reloaded
+	HTMLElement* GetElementById(const std::string& id);
+	std::vector<HTMLElement*> GetElementsByClassName(const std::string& className);
+
+	// Changes are only recorded here, the affected elements are restyled and laid out by FlushUpdates
+	void SetText(HTMLElement* element, const std::string& text);
+	void SetAttribute(HTMLElement* element, const std::string& name, const std::string& value);
+	void AddClass(HTMLElement* element, const std::string& className);
+	void RemoveClass(HTMLElement* element, const std::string& className);
+	void SetStyle(HTMLElement* element, const std::string& property, const std::string& value);
+
+	// Changes made between BeginUpdate and EndUpdate are held back and flushed together
+	void BeginUpdate();
+	void EndUpdate();
+	// Applies all pending changes, Update calls this once before drawing
+	void FlushUpdates();
+
+	/* ---Bindings--- */
+	// Shows the value as the text of the element with the given id, kept up to date as the value changes
+	void Bind(const std::string& id, Binding::Observable& value);
+	// Same as Bind, and typing into the element while it has focus edits the value
+	void BindInput(const std::string& id, Bindable<std::string>& value);
+	void Unbind(const std::string& id);
 
 	/* ---Callbacks--- */
+	// Each one stamps its event for Latency and appends it to the InputScript recording
 	void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 	void char_callback(GLFWwindow* window, unsigned int codepoint);
 	void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+	void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+	void cursor_position_callback(GLFWwindow* window, double x, double y);
+	void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 }
\ No newline at end of file
@@ -0,0 +1,386 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <chrono>
+#include <optional>
+#include <algorithm>
+
+#include "Lucid/gui.hpp"
+#include "Lucid/Renderer/BoxRenderer.hpp"
+#include "Lucid/Renderer/GLState.hpp"
+#include "Lucid/Renderer/RenderStats.hpp"
+#include "Lucid/Memory/MemoryStats.hpp"
+
+// Renders a generated page offscreen for a fixed number of frames and prints the timings and counters as json.
+// Needs no GPU when run on Mesa's software GL: LIBGL_ALWAYS_SOFTWARE=1 on Linux, Mesa's opengl32.dll next to the exe on Windows.
+// Exits with 1 when a budget is exceeded, 2 when it couldn't run, e.g.
+//   Bench --labels 5000 --fonts 4 --frames 600 --budgets budgets.txt --max-p95 8 --out result.json
+// With --replay the frames come from an InputScript instead: its events go through the window's callbacks into a
+// focused input on the page, and a frame is only drawn when they changed something, as in Lucid::Update.
+// The input to present latency of the events is reported and can be budgeted too, e.g.
+//   Bench --replay typing.txt --max-inputP95 4
+
+struct Options {
+	int labels = 2000;
+	int fonts = 2;
+	int sizes = 4;
+	int paragraphs = 20;
+	int paragraphWords = 80;
+	int frames = 300;
+	int warmup = 10;
+	int width = 1280;
+	int height = 720;
+	std::string out; // also written here if set
+	std::string replay; // input script
+
+	// Not checked when negative. Times are in milliseconds, counts are per frame after the warmup
+	std::map<std::string, double> budgets = {
+		{ "p50", -1.0 }, { "p95", -1.0 }, { "p99", -1.0 },
+		{ "inputP50", -1.0 }, { "inputP95", -1.0 }, { "inputP99", -1.0 },
+		{ "drawCalls", -1.0 }, { "glCalls", -1.0 }, { "glyphRasterizations", -1.0 }, { "bytesUploaded", -1.0 }
+	};
+};
+
+struct Frame {
+	double milliseconds = 0.0;
+	Lucid::RenderStats::Stats stats;
+	uint64_t glCalls = 0;
+};
+
+bool ReadBudgets(const std::string& path, Options& options)
+{
+	std::ifstream file(path);
+	if (!file) {
+		std::cout << "Failed to open budgets file: " << path << std::endl;
+		return false;
+	}
+
+	// One "name value" pair per line, # starts a comment
+	std::string line;
+	while (std::getline(file, line)) {
+		line = line.substr(0, line.find('#'));
+		std::istringstream words(line);
+		std::string name;
+		double value;
+		if (!(words >> name >> value)) continue;
+
+		if (!options.budgets.count(name)) {
+			std::cout << "Unknown budget: " << name << std::endl;
+			return false;
+		}
+		options.budgets[name] = value;
+	}
+	return true;
+}
+
+bool ParseArguments(int argc, char** argv, Options& options)
+{
+	std::map<std::string, int*> counts = {
+		{ "--labels", &options.labels }, { "--fonts", &options.fonts }, { "--sizes", &options.sizes },
+		{ "--paragraphs", &options.paragraphs }, { "--paragraph-words", &options.paragraphWords },
+		{ "--frames", &options.frames }, { "--warmup", &options.warmup },
+		{ "--width", &options.width }, { "--height", &options.height }
+	};
+
+	for (int i = 1; i < argc; ++i) {
+		std::string name = argv[i];
+		if (i + 1 >= argc) {
+			std::cout << "Missing value for " << name << std::endl;
+			return false;
+		}
+		std::string value = argv[++i];
+
+		try {
+			if (counts.count(name)) *counts[name] = std::max(0, std::stoi(value));
+			else if (name == "--out") options.out = value;
+			else if (name == "--replay") options.replay = value;
+			else if (name == "--budgets") {
+				if (!ReadBudgets(value, options)) return false;
+			}
+			// --max-p95 12.5 and so on, overrides the budgets file
+			else if (name.rfind("--max-", 0) == 0 && options.budgets.count(name.substr(6))) options.budgets[name.substr(6)] = std::stod(value);
+			else {
+				std::cout << "Unknown option: " << name << std::endl;
+				return false;
+			}
+		}
+		catch (const std::exception&) {
+			std::cout << "Invalid value for " << name << ": " << value << std::endl;
+			return false;
+		}
+	}
+
+	options.fonts = std::max(1, options.fonts);
+	options.sizes = std::max(1, options.sizes);
+	options.frames = std::max(1, options.frames);
+	options.width = std::max(1, options.width);
+	options.height = std::max(1, options.height);
+	return true;
+}
+
+// Labels are tiled over the viewport again and again so every one of them is drawn,
+// the paragraphs are single long lines that run off the right edge
+std::pair<std::string, std::string> GeneratePage(const Options& options)
+{
+	std::ostringstream html, css;
+
+	for (int font = 0; font < options.fonts; ++font) {
+		css << ".f" << font << " { font-family: Bench" << font << "; }\n";
+	}
+	for (int size = 0; size < options.sizes; ++size) {
+		css << ".s" << size << " { font-size: " << 12 + size * 4 << "px; color: #e0e0e0; }\n";
+	}
+	css << ".boxed { background: #203040; border: 1px solid #6080a0; border-radius: 3px; padding: 2px; }\n";
+	css << ".paragraph { font-size: 14px; color: white; font-family: Bench0; }\n";
+
+	const int columnWidth = 160, rowHeight = 28;
+	const int columns = std::max(1, options.width / columnWidth);
+	const int rows = std::max(1, options.height / rowHeight);
+	for (int i = 0; i < options.labels; ++i) {
+		int cell = i % (columns * rows);
+		int pass = i / (columns * rows);
+		int left = (cell % columns) * columnWidth + (pass * 7) % columnWidth;
+		int top = (cell / columns) * rowHeight + (pass * 3) % rowHeight;
+
+		html << "<p class=\"f" << i % options.fonts << " s" << i % options.sizes << (i % 4 == 0 ? " boxed" : "")
+			<< "\" style=\"top: " << top << "px; left: " << left << "px;\">Label " << i << "</p>\n";
+	}
+
+	// Where replayed typing goes
+	if (!options.replay.empty()) {
+		html << "<p id=\"input\" class=\"f0 s" << options.sizes - 1 << " boxed\" style=\"top: 0px; left: 0px;\"></p>\n";
+	}
+
+	const char* words[] = { "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit", "sed", "do", "eiusmod", "tempor" };
+	for (int i = 0; i < options.paragraphs; ++i) {
+		html << "<p class=\"paragraph\" style=\"top: " << (i * rowHeight) % options.height << "px; left: 0px;\">";
+		for (int word = 0; word < options.paragraphWords; ++word) {
+			html << (word ? " " : "") << words[(i + word) % std::size(words)];
+		}
+		html << "</p>\n";
+	}
+
+	return { html.str(), css.str() };
+}
+
+double Percentile(std::vector<double> sorted, double percentile)
+{
+	if (sorted.empty()) return 0.0;
+	size_t index = static_cast<size_t>(percentile / 100.0 * (sorted.size() - 1) + 0.5);
+	return sorted[std::min(index, sorted.size() - 1)];
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseArguments(argc, argv, options)) return 2;
+
+	std::vector<Lucid::InputScript::Event> script;
+	if (!options.replay.empty()) {
+		try {
+			script = Lucid::InputScript::Load(options.replay);
+		}
+		catch (const std::exception& ex) {
+			std::cout << ex.what() << std::endl;
+			return 2;
+		}
+	}
+
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	// Only there for the context, frames go into a framebuffer of our own
+	GLFWwindow* window = glfwCreateWindow(64, 64, "bench", nullptr, nullptr);
+	if (window == nullptr) {
+		std::cout << "Failed to create window" << std::endl;
+		glfwTerminate();
+		return 2;
+	}
+	glfwMakeContextCurrent(window);
+	glfwSwapInterval(0);
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		glfwTerminate();
+		return 2;
+	}
+
+	GLuint framebuffer, colorBuffer;
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, options.width, options.height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "Failed to create the offscreen framebuffer" << std::endl;
+		glfwTerminate();
+		return 2;
+	}
+	glViewport(0, 0, options.width, options.height);
+
+	auto page = GeneratePage(options);
+
+	std::vector<Frame> frames;
+	Frame firstFrame;
+	double loadMilliseconds = 0.0;
+	Lucid::MemoryStats::DocumentUsage documentMemory;
+	Lucid::MemoryStats::SharedUsage sharedMemory;
+	Lucid::Latency::Histogram inputLatency;
+	{
+		Lucid::Document document;
+		Lucid::Bindable<std::string> typed;
+		try {
+			// No binary cache, every run measures the compile
+			Lucid::ShaderManager::CompileAll();
+			Lucid::Text::Init();
+			Lucid::BoxRenderer::Init();
+			Lucid::ImageRenderer::Init();
+			// Each name gets its own glyph cache, so alternating the two fonts we ship costs the same as distinct fonts
+			const char* files[] = { "Lucid/Fonts/arial.ttf", "Lucid/Fonts/BRADHITC.TTF" };
+			for (int font = 0; font < options.fonts; ++font) {
+				Lucid::Text::LoadFontFromMemory("Bench" + std::to_string(font), Lucid::Resources::Get(files[font % 2]), font == 0);
+			}
+			// The window's key callback switches to it on shift
+			Lucid::Text::LoadFontFromMemory("Arial", Lucid::Resources::Get(files[0]), false);
+
+			auto start = std::chrono::steady_clock::now();
+			document.SetViewportSize(glm::vec2(options.width, options.height));
+			document.LoadPageSource(page.first, page.second);
+			loadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			if (!script.empty()) {
+				// The callbacks work on the window's document
+				Lucid::SetDocument(&document);
+				document.SetViewportSize(glm::vec2(options.width, options.height));
+				document.BindInput("input", typed);
+				document.SetFocus("input");
+			}
+		}
+		catch (const std::exception& ex) {
+			std::cout << "Failed to set up the benchmark: " << ex.what() << std::endl;
+			glfwTerminate();
+			return 2;
+		}
+
+		// Every frame is waited on, so the time includes the driver's work
+		auto drawFrame = [&](bool force) {
+			Lucid::RenderStats::ResetStats();
+			Lucid::GLState::ResetStats();
+
+			Frame result;
+			auto start = std::chrono::steady_clock::now();
+			if (force) document.RequestReDraw();
+			document.Update();
+			if (!document.NeedsReDraw()) {
+				Lucid::Latency::DiscardPending();
+				return std::optional<Frame>();
+			}
+
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			document.Draw();
+			glFinish();
+			Lucid::Latency::MarkPresented();
+
+			result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			result.stats = Lucid::RenderStats::GetStats();
+			result.glCalls = result.stats.totalGLCalls();
+			return std::optional<Frame>(result);
+		};
+
+		// Replays draw only what the input changed, the warmup still draws everything
+		int drawnFrames = script.empty() ? options.warmup + options.frames : options.warmup;
+		for (int frame = 0; frame < drawnFrames; ++frame) {
+			Frame result = *drawFrame(true);
+			if (frame == 0) firstFrame = result;
+			if (frame >= options.warmup) frames.push_back(result);
+		}
+
+		Lucid::Latency::Reset();
+		for (size_t next = 0; next < script.size();) {
+			// One frame's worth of input, then the frame
+			for (; next < script.size() && script[next].type != Lucid::InputScript::Event::Frame; ++next) {
+				Lucid::InputScript::Dispatch(script[next]);
+			}
+			++next;
+
+			std::optional<Frame> result = drawFrame(false);
+			if (result) frames.push_back(*result);
+		}
+		inputLatency = Lucid::Latency::GetHistogram();
+		if (!script.empty()) Lucid::SetDocument(nullptr);
+
+		documentMemory = document.GetMemoryUsage();
+		sharedMemory = Lucid::MemoryStats::GetSharedUsage();
+	}
+
+	glDeleteRenderbuffers(1, &colorBuffer);
+	glDeleteFramebuffers(1, &framebuffer);
+	glfwDestroyWindow(window);
+	glfwTerminate();
+
+	std::vector<double> times;
+	std::map<std::string, double> worst = { { "drawCalls", 0.0 }, { "glCalls", 0.0 }, { "glyphRasterizations", 0.0 }, { "bytesUploaded", 0.0 } };
+	for (const Frame& frame : frames) {
+		times.push_back(frame.milliseconds);
+		worst["drawCalls"] = std::max(worst["drawCalls"], double(frame.stats.drawCalls));
+		worst["glCalls"] = std::max(worst["glCalls"], double(frame.glCalls));
+		worst["glyphRasterizations"] = std::max(worst["glyphRasterizations"], double(frame.stats.glyphRasterizations));
+		worst["bytesUploaded"] = std::max(worst["bytesUploaded"], double(frame.stats.bytesUploaded));
+	}
+	std::sort(times.begin(), times.end());
+
+	std::map<std::string, double> measured = worst;
+	measured["p50"] = Percentile(times, 50.0);
+	measured["p95"] = Percentile(times, 95.0);
+	measured["p99"] = Percentile(times, 99.0);
+	measured["inputP50"] = inputLatency.Percentile(50.0);
+	measured["inputP95"] = inputLatency.Percentile(95.0);
+	measured["inputP99"] = inputLatency.Percentile(99.0);
+	const Lucid::ShaderManager::Stats& shaders = Lucid::ShaderManager::GetStats();
+
+	std::vector<std::string> exceeded;
+	for (const auto& [name, budget] : options.budgets) {
+		if (budget >= 0.0 && measured[name] > budget) exceeded.push_back(name);
+	}
+
+	std::ostringstream json;
+	json.precision(12); // counts above a million would come out in exponent form otherwise
+	json << "{\n"
+		<< "  \"page\": { \"labels\": " << options.labels << ", \"fonts\": " << options.fonts << ", \"sizes\": " << options.sizes
+		<< ", \"paragraphs\": " << options.paragraphs << ", \"paragraphWords\": " << options.paragraphWords
+		<< ", \"width\": " << options.width << ", \"height\": " << options.height << " },\n"
+		<< "  \"frames\": " << frames.size() << ",\n"
+		<< "  \"loadMs\": " << loadMilliseconds << ",\n"
+		<< "  \"shaders\": { \"compiled\": " << shaders.compiled << ", \"failed\": " << shaders.failed << ", \"ms\": " << shaders.milliseconds << " },\n"
+		<< "  \"firstFrame\": { \"ms\": " << firstFrame.milliseconds << ", \"drawCalls\": " << firstFrame.stats.drawCalls
+		<< ", \"glCalls\": " << firstFrame.glCalls << ", \"glyphRasterizations\": " << firstFrame.stats.glyphRasterizations
+		<< ", \"bytesUploaded\": " << firstFrame.stats.bytesUploaded << " },\n"
+		<< "  \"frameMs\": { \"p50\": " << measured["p50"] << ", \"p95\": " << measured["p95"] << ", \"p99\": " << measured["p99"]
+		<< ", \"min\": " << (times.empty() ? 0.0 : times.front()) << ", \"max\": " << (times.empty() ? 0.0 : times.back()) << " },\n"
+		<< "  \"perFrame\": { \"drawCalls\": " << worst["drawCalls"] << ", \"glCalls\": " << worst["glCalls"]
+		<< ", \"glyphRasterizations\": " << worst["glyphRasterizations"] << ", \"bytesUploaded\": " << worst["bytesUploaded"] << " },\n"
+		<< "  \"inputMs\": { \"events\": " << inputLatency.Count() << ", \"mean\": " << inputLatency.Mean() << ", \"p50\": " << measured["inputP50"]
+		<< ", \"p95\": " << measured["inputP95"] << ", \"p99\": " << measured["inputP99"] << ", \"max\": " << inputLatency.Max() << " },\n"
+		<< "  \"memory\": { \"document\": " << documentMemory.bytes() << ", \"domNodes\": " << documentMemory.dom.count
+		<< ", \"textElements\": " << documentMemory.textElements.count << ", \"sharedCPU\": " << sharedMemory.cpuBytes()
+		<< ", \"sharedGPU\": " << sharedMemory.gpuBytes() << " },\n"
+		<< "  \"exceeded\": [";
+	for (size_t i = 0; i < exceeded.size(); ++i) {
+		json << (i ? ", " : "") << "{ \"budget\": \"" << exceeded[i] << "\", \"limit\": " << options.budgets[exceeded[i]]
+			<< ", \"measured\": " << measured[exceeded[i]] << " }";
+	}
+	json << "]\n}\n";
+
+	std::cout << json.str();
+	if (!options.out.empty()) std::ofstream(options.out) << json.str();
+
+	return exceeded.empty() ? EXIT_SUCCESS : 1;
+}
@@ -2,10 +2,20 @@
 #include "Lucid/gui.hpp"
 
 int main() {
+#ifdef _DEBUG
+	// Edits to the pages and shaders under src show up without rebuilding
+	Lucid::Resources::SetOverrideDirectory(std::filesystem::current_path() / "src");
+#endif
 	Lucid::Init("demo");
+	Lucid::EnableHotReload();
 
-	std::string test = "";
-	Lucid::BindInput("test", &test);
+	Lucid::Bindable<std::string> test;
+	Lucid::BindInput("test", test);
+	Lucid::GetDocument().SetFocus("test");
+
+	Lucid::GetDocument().CreateList("log", 1000000, [](size_t index) {
+		return "Log entry " + std::to_string(index);
+	});
 
 	while (!Lucid::WindowShouldClose()) {
 		Lucid::Update();
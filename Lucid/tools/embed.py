@@ -0,0 +1,76 @@
+# Writes every shader, font and page under the source directory into a C++ file as constexpr byte arrays,
+# so the binary starts without reading them from disk. Runs as a pre-build step:
+#   python embed.py <source directory> <output .cpp>
+# The output is only rewritten when something changed, so unchanged resources don't trigger a recompile
+import os
+import sys
+import tempfile
+
+EXTENSIONS = {".vert", ".frag", ".ttf", ".html", ".css"}
+
+
+def collect(root):
+    files = []
+    for directory, _, names in os.walk(root):
+        for name in names:
+            if os.path.splitext(name)[1].lower() in EXTENSIONS:
+                path = os.path.join(directory, name)
+                files.append((os.path.relpath(path, root).replace(os.sep, "/"), path))
+    # Resources.cpp binary searches the table
+    return sorted(files)
+
+
+def generate(files):
+    out = ["// Generated by tools/embed.py from the files under src, do not edit", '#include "Embedded.hpp"', "",
+           "namespace Lucid {", "\tnamespace Resources {", "\t\tnamespace {"]
+    for index, (name, path) in enumerate(files):
+        with open(path, "rb") as file:
+            data = file.read()
+        out.append("\t\t\t// %s" % name)
+        out.append("\t\t\tconstexpr unsigned char data%d[] = {" % index)
+        # Empty arrays aren't allowed, the size in the table stays 0
+        data_bytes = data or b"\0"
+        for start in range(0, len(data_bytes), 24):
+            out.append("\t\t\t\t" + ",".join("0x%02x" % byte for byte in data_bytes[start:start + 24]) + ",")
+        out.append("\t\t\t};")
+    out.append("")
+    out.append("\t\t\tconstexpr Entry table[] = {")
+    for index, (name, path) in enumerate(files):
+        size = "sizeof(data%d)" % index if os.path.getsize(path) else "0"
+        out.append('\t\t\t\t{ "%s", data%d, %s },' % (name, index, size))
+    if not files:
+        out.append('\t\t\t\t{ "", nullptr, 0 },')
+    out.append("\t\t\t};")
+    out.append("\t\t\tstatic_assert(IsSorted(table));")
+    out.append("\t\t}")
+    out.append("")
+    out.append("\t\tconst std::span<const Entry> entries(table, %d);" % len(files))
+    out.append("\t}")
+    out.append("}")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    if len(sys.argv) != 3:
+        print("usage: embed.py <source directory> <output .cpp>")
+        return 1
+
+    root, output = sys.argv[1], sys.argv[2]
+    source = generate(collect(root))
+
+    if os.path.exists(output):
+        with open(output, "r", newline="") as file:
+            if file.read() == source:
+                return 0
+
+    # Both projects run this before building, a reader must never see a half written file
+    handle, temporary = tempfile.mkstemp(dir=os.path.dirname(os.path.abspath(output)), suffix=".tmp")
+    with os.fdopen(handle, "w", newline="") as file:
+        file.write(source)
+    os.replace(temporary, output)
+    print("Embedded resources written to %s" % output)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())